@@ -0,0 +1,66 @@
+// This example measures the delay from the DAC output to the ADC input, with A12
+// connected to A0. The ADC and DAC are started on the same timer event by a sync
+// group, so the impulse written to the DAC is captured at the same ADC sample on
+// every run.
+#include <Arduino_AdvancedAnalog.h>
+
+AdvancedADC adc(A0);
+AdvancedDAC dac(A12);
+AdvancedSync sync;
+size_t n_captured = 0;
+bool found = false;
+
+void setup() {
+    Serial.begin(9600);
+
+    // Members are added before begin(), so that begin() doesn't start them.
+    if (!sync.add(adc) || !sync.add(dac)) {
+        Serial.println("Failed to create sync group!");
+        while (1);
+    }
+
+    // Resolution, sample rate, number of samples per buffer, queue depth.
+    if (!adc.begin(AN_RESOLUTION_12, 32000, 64, 16) || !dac.begin(AN_RESOLUTION_12, 32000, 64, 16)) {
+        Serial.println("Failed to start analog acquisition!");
+        while (1);
+    }
+
+    // Queue an impulse followed by silence. The DAC's DMA starts with the third
+    // buffer, but its timer is held until the group is started.
+    for (int i=0; i<3; i++) {
+        SampleBuffer buf = dac.dequeue();
+        for (size_t j=0; j<buf.size(); j++) {
+            buf[j] = (i == 0 && j == 0) ? 0xFFF : 0;
+        }
+        dac.write(buf);
+    }
+
+    if (!sync.start()) {
+        Serial.println("Failed to start sync group!");
+        while (1);
+    }
+}
+
+void loop() {
+    // Keep the DAC fed with silence.
+    if (dac.available()) {
+        SampleBuffer buf = dac.dequeue();
+        for (size_t i=0; i<buf.size(); i++) {
+            buf[i] = 0;
+        }
+        dac.write(buf);
+    }
+
+    if (adc.available()) {
+        SampleBuffer buf = adc.read();
+        for (size_t i=0; i<buf.size() && !found; i++) {
+            if (buf[i] > 2048) {
+                Serial.print("Impulse captured at ADC sample ");
+                Serial.println(n_captured + i);
+                found = true;
+            }
+        }
+        n_captured += buf.size();
+        buf.release();
+    }
+}
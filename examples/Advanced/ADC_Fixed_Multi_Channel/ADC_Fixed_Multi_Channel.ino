@@ -0,0 +1,27 @@
+// This example captures two channels with a fixed configuration. The sample buffers
+// are allocated statically with the ADC object, and each buffer is converted to
+// normalized float samples, one array per channel.
+#include <Arduino_AdvancedAnalog.h>
+
+// Channels, samples per channel, queue depth, sample type.
+AdvancedADCFixed<2, 32, 16, float> adc(A0, A1);
+float samples[2][32];
+uint64_t last_millis = 0;
+
+void setup() {
+    Serial.begin(9600);
+
+    // Resolution, sample rate.
+    if (!adc.begin(AN_RESOLUTION_16, 16000)) {
+        Serial.println("Failed to start analog acquisition!");
+        while (1);
+    }
+}
+
+void loop() {
+    if (adc.read(samples) && millis() - last_millis > 1) {
+        Serial.println(samples[0][0]);  // Print sample from first channel
+        Serial.println(samples[1][0]);  // Print sample from second channel
+        last_millis = millis();
+    }
+}
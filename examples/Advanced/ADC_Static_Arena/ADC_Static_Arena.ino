@@ -0,0 +1,54 @@
+// This example places the ADC sample buffers in a statically allocated arena, so
+// that restarting the ADC doesn't allocate buffer memory from the heap. It restarts
+// the ADC repeatedly, and prints the longest time begin() took with and without the
+// arena.
+#include <Arduino_AdvancedAnalog.h>
+
+#define N_SAMPLES   (256)
+#define N_BUFFERS   (8)
+
+AdvancedADC adc(A0, A1);
+
+// Buffers for N_BUFFERS x N_SAMPLES samples of 2 channels, aligned to the cache line size.
+alignas(32) static uint8_t arena[AN_DMA_ARENA_SIZE(Sample, N_SAMPLES, 2, N_BUFFERS)];
+
+uint32_t restart_time(size_t n_restarts) {
+    uint32_t max_time = 0;
+    for (size_t i=0; i<n_restarts; i++) {
+        uint32_t start = micros();
+        if (!adc.begin(AN_RESOLUTION_16, 16000, N_SAMPLES, N_BUFFERS)) {
+            Serial.println("Failed to start the ADC!");
+            while (1);
+        }
+        max_time = max(max_time, micros() - start);
+
+        // Allocate something in between, so the heap is fragmented over time.
+        void *p = malloc(1 + (i * 37) % 1024);
+        while (!adc.available()) {
+
+        }
+        adc.read().release();
+        adc.stop();
+        free(p);
+    }
+    return max_time;
+}
+
+void setup() {
+    Serial.begin(9600);
+    while (!Serial) {
+
+    }
+
+    Serial.print("Heap: ");
+    Serial.print(restart_time(100));
+    Serial.println("us max");
+
+    adc.dma_memory(AN_DMA_MEM_CACHED, arena, sizeof(arena));
+    Serial.print("Arena: ");
+    Serial.print(restart_time(100));
+    Serial.println("us max");
+}
+
+void loop() {
+}
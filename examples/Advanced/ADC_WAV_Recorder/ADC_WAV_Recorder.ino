@@ -0,0 +1,77 @@
+// This example records 2 ADC channels to a WAV file for 10 seconds.
+// To run this sketch, rename 'USB_DRIVE' to the name of your USB
+// stick drive.
+#include <Arduino_AdvancedAnalog.h>
+#include <Arduino_USBHostMbed5.h>
+#include <FATFileSystem.h>
+
+USBHostMSD msd;
+mbed::FATFileSystem usb("USB_DRIVE");
+
+AdvancedADC adc(A0, A1);
+WavWriter wav;
+
+#define SAMPLE_RATE (48000)
+#define N_SAMPLES   (256)
+#define DURATION_MS (10000)
+
+uint32_t start_ms = 0;
+uint32_t dropped = 0;
+
+void setup() {
+    Serial.begin(9600);
+    while (!Serial) {
+
+    }
+
+    // Enable power for HOST USB connector.
+    pinMode(PA_15, OUTPUT);
+    digitalWrite(PA_15, HIGH);
+
+    Serial.println("Please connect a USB stick to the USB host port...");
+    while (!msd.connect()) {
+        delay(100);
+    }
+
+    Serial.println("Mounting USB device...");
+    int const rc_mount = usb.mount(&msd);
+    if (rc_mount) {
+        Serial.print("Error mounting USB device ");
+        Serial.println(rc_mount);
+        while (1);
+    }
+
+    // Path, sample rate, number of channels, resolution, signed samples, number of blocks.
+    if (!wav.begin("/USB_DRIVE/RECORDING.wav", SAMPLE_RATE, 2, AN_RESOLUTION_12, false, 16)) {
+        Serial.println("Failed to create the WAV file");
+        while (1);
+    }
+
+    // Resolution, sample rate, number of samples per channel, queue depth.
+    if (!adc.begin(AN_RESOLUTION_12, SAMPLE_RATE, N_SAMPLES, 32)) {
+        Serial.println("Failed to start analog acquisition!");
+        while (1);
+    }
+
+    Serial.println("Recording...");
+    start_ms = millis();
+}
+
+void loop() {
+    if (start_ms && (millis() - start_ms) > DURATION_MS) {
+        adc.stop();
+        wav.stop();
+        start_ms = 0;
+        Serial.print("Done, dropped buffers: ");
+        Serial.println(dropped);
+    }
+
+    if (start_ms && adc.available()) {
+        SampleBuffer buf = adc.read();
+        // The samples are copied to the writer's queue, and written in the background.
+        if (!wav.write(buf)) {
+            dropped++;
+        }
+        buf.release();
+    }
+}
@@ -0,0 +1,76 @@
+// This example generates a sine sweep on A12/DAC1 using the DDS generator, and prints
+// a benchmark comparing it to computing every sample with sinf().
+
+#include <Arduino_AdvancedAnalog.h>
+
+#define N_SAMPLES       (256)
+#define SAMPLE_RATE     (32000)
+#define BENCH_BLOCKS    (1000)
+
+AdvancedDAC dac1(A12);
+DDSGenerator dds;
+Sample bench_buf[N_SAMPLES];
+
+void benchmark() {
+    // Baseline: one sinf() call per sample.
+    float phase = 0.0f;
+    uint32_t t0 = micros();
+    for (size_t b=0; b<BENCH_BLOCKS; b++) {
+        for (size_t i=0; i<N_SAMPLES; i++) {
+            bench_buf[i] = sinf(phase) * 2047 + 2048;
+            phase += 2.0f * PI * 1000.0f / SAMPLE_RATE;
+            if (phase > 2.0f * PI) {
+                phase -= 2.0f * PI;
+            }
+        }
+    }
+    uint32_t t_sinf = micros() - t0;
+
+    // DDS: fixed-point phase accumulator and interpolated table lookup.
+    t0 = micros();
+    for (size_t b=0; b<BENCH_BLOCKS; b++) {
+        dds.generate(bench_buf, N_SAMPLES);
+    }
+    uint32_t t_dds = micros() - t0;
+
+    Serial.print("sinf(): ");
+    Serial.print((float) (BENCH_BLOCKS * N_SAMPLES) / t_sinf);
+    Serial.println(" samples/us");
+    Serial.print("DDS:    ");
+    Serial.print((float) (BENCH_BLOCKS * N_SAMPLES) / t_dds);
+    Serial.println(" samples/us");
+}
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) {
+
+    }
+
+    // Resolution, sample rate, waveform.
+    if (!dds.begin(AN_RESOLUTION_12, SAMPLE_RATE, AN_WAVE_SINE)) {
+        Serial.println("Failed to start DDS!");
+        while (1);
+    }
+    dds.frequency(1000);
+    benchmark();
+
+    if (!dac1.begin(AN_RESOLUTION_12, SAMPLE_RATE, N_SAMPLES, 32)) {
+        Serial.println("Failed to start DAC1 !");
+        while (1);
+    }
+}
+
+void loop() {
+    static float frequency = 100.0f;
+
+    if (dac1.available()) {
+        // Sweep from 100Hz to 4KHz; frequency changes are phase-continuous.
+        frequency = (frequency < 4000.0f) ? (frequency * 1.01f) : 100.0f;
+        dds.frequency(frequency);
+
+        SampleBuffer buf = dac1.dequeue();
+        dds.generate(buf);
+        dac1.write(buf);
+    }
+}
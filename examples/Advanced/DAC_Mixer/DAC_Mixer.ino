@@ -0,0 +1,54 @@
+// This example mixes the signal captured on A0 with a generated 440Hz tone, and
+// outputs the result on A12/DAC1. The mixer converts the sources, applies per-source
+// gains and saturates the sum in a single pass over the samples.
+
+#include <Arduino_AdvancedAnalog.h>
+
+#define N_SAMPLES       (256)
+#define SAMPLE_RATE     (32000)
+
+AdvancedADC adc1(A0);
+AdvancedDAC dac1(A12);
+DDSGenerator tone;
+SampleMixer mixer;
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) {
+
+    }
+
+    // Resolution, number of samples per channel, number of channels.
+    if (!mixer.begin(AN_RESOLUTION_12, N_SAMPLES, 1)) {
+        Serial.println("Failed to start the mixer!");
+        while (1);
+    }
+
+    if (!tone.begin(AN_RESOLUTION_12, SAMPLE_RATE)) {
+        Serial.println("Failed to start the tone generator!");
+        while (1);
+    }
+    tone.frequency(440);
+
+    if (!adc1.begin(AN_RESOLUTION_12, SAMPLE_RATE, N_SAMPLES, 32)) {
+        Serial.println("Failed to start ADC1!");
+        while (1);
+    }
+
+    if (!dac1.begin(AN_RESOLUTION_12, SAMPLE_RATE, N_SAMPLES, 32)) {
+        Serial.println("Failed to start DAC1!");
+        while (1);
+    }
+
+    // Source, gain (and resolution for ADC sources).
+    mixer.add(adc1, 0.7f, AN_RESOLUTION_12);
+    mixer.add(tone, 0.3f);
+}
+
+void loop() {
+    if (mixer.available() && dac1.available()) {
+        SampleBuffer buf = dac1.dequeue();
+        mixer.mix(buf);
+        dac1.write(buf);
+    }
+}
@@ -0,0 +1,73 @@
+// This example shows how to play a WAV image held in memory with the DAC.
+// The DMA reads the samples in place, so there's no file I/O and no copying
+// to sample buffers. Sound effects are normally stored as const arrays in
+// flash (e.g. converted with `xxd -i`) or in memory-mapped QSPI flash; this
+// example builds a short 8-bit mono WAV image in RAM instead.
+#include <Arduino_AdvancedAnalog.h>
+
+AdvancedDAC dac1(A12);
+WavImage wav;
+
+static uint8_t image[44 + 8000];
+
+static void put_le(uint8_t *p, uint32_t v, size_t n) {
+    for (size_t i=0; i<n; i++) {
+        p[i] = (v >> (i * 8)) & 0xFF;
+    }
+}
+
+static void make_image(uint32_t sample_rate) {
+    size_t n_samples = sizeof(image) - 44;
+    memcpy(&image[0], "RIFF", 4);
+    put_le(&image[4], sizeof(image) - 8, 4);
+    memcpy(&image[8], "WAVEfmt ", 8);
+    put_le(&image[16], 16, 4);              // fmt chunk size
+    put_le(&image[20], 1, 2);               // PCM
+    put_le(&image[22], 1, 2);               // Mono
+    put_le(&image[24], sample_rate, 4);
+    put_le(&image[28], sample_rate, 4);     // Byte rate
+    put_le(&image[32], 1, 2);               // Block align
+    put_le(&image[34], 8, 2);               // Bits per sample
+    memcpy(&image[36], "data", 4);
+    put_le(&image[40], n_samples, 4);
+
+    // A 500Hz tone that fades out. 8-bit WAV samples are unsigned.
+    for (size_t i=0; i<n_samples; i++) {
+        float amp = 127.0f * (n_samples - i) / n_samples;
+        image[44 + i] = 128 + (int) (amp * sin(2.0f * PI * 500.0f * i / sample_rate));
+    }
+}
+
+void setup() {
+    Serial.begin(9600);
+
+    while (!Serial) {
+
+    }
+
+    make_image(16000);
+    if (!wav.begin(image, sizeof(image))) {
+        Serial.println("Invalid WAV image!");
+        while (1);
+    }
+
+    // The DAC must use 8-bit resolution to play 8-bit WAV data in place. The buffers
+    // set the DMA transfer size, and two of them are used for the end of the samples.
+    if (!dac1.begin(AN_RESOLUTION_8, wav.sample_rate(), 256, 2)) {
+        Serial.println("Failed to start DAC1 !");
+        while (1);
+    }
+}
+
+void loop() {
+    static uint32_t start = 0;
+
+    // Play the sound every second. The CPU is only used once per 256 samples, to
+    // point the DMA at the next block.
+    if (!dac1.playing() && millis() - start >= 1000) {
+        start = millis();
+        if (!dac1.play(wav)) {
+            Serial.println("Failed to play WAV image!");
+        }
+    }
+}
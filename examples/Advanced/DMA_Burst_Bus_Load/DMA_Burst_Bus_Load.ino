@@ -0,0 +1,94 @@
+// This example measures the bus load of several concurrent high-rate DMA streams,
+// with single transfers and with memory bursts. Two ADCs and the DAC run at 1MHz,
+// while the CPU copies a buffer in memory; the drop in copy throughput compared to
+// an idle bus shows how much bus time the DMA streams take.
+#include <Arduino_AdvancedAnalog.h>
+
+#define SAMPLE_RATE (1000000)
+#define N_SAMPLES   (256)
+#define N_BUFFERS   (8)
+
+static uint32_t src[4096];
+static uint32_t dst[4096];
+
+struct {
+    const char *name;
+    uint32_t burst;
+    uint32_t fifo;
+} configs[] = {
+    { "Single transfers", AN_DMA_BURST_SINGLE, AN_DMA_FIFO_FULL },
+    { "4-beat bursts", AN_DMA_BURST_INC4, AN_DMA_FIFO_1_2 },
+    { "8-beat bursts", AN_DMA_BURST_INC8, AN_DMA_FIFO_FULL },
+};
+
+float copy_throughput(AdvancedADC *adcs, size_t n_adcs) {
+    size_t n_bytes = 0;
+    uint32_t start = millis();
+    while (millis() - start < 1000) {
+        memcpy(dst, src, sizeof(src));
+        n_bytes += sizeof(src);
+        // Keep the streams running.
+        for (size_t i=0; i<n_adcs; i++) {
+            if (adcs[i].available()) {
+                adcs[i].read().release();
+            }
+        }
+    }
+    return n_bytes / (1024.0f * 1024.0f);
+}
+
+void setup() {
+    Serial.begin(9600);
+    while (!Serial) {
+
+    }
+
+    float idle = copy_throughput(nullptr, 0);
+    Serial.print("Idle bus: ");
+    Serial.print(idle);
+    Serial.println("MB/s");
+
+    for (size_t i=0; i<AN_ARRAY_SIZE(configs); i++) {
+        AdvancedADC adcs[] = { AdvancedADC(A0), AdvancedADC(A1) };
+        AdvancedDAC dac(A12);
+
+        bool ok = true;
+        for (size_t j=0; j<AN_ARRAY_SIZE(adcs); j++) {
+            ok = ok && adcs[j].dma_burst(configs[i].burst, configs[i].fifo) &&
+                       adcs[j].begin(AN_RESOLUTION_12, SAMPLE_RATE, N_SAMPLES, N_BUFFERS);
+        }
+
+        // The DAC runs in loop mode, so it doesn't need any CPU time.
+        ok = ok && dac.dma_burst(configs[i].burst, configs[i].fifo) &&
+                   dac.begin(AN_RESOLUTION_12, SAMPLE_RATE, N_SAMPLES, N_BUFFERS, true);
+        while (ok && dac.available()) {
+            SampleBuffer buf = dac.dequeue();
+            for (size_t k=0; k<buf.size(); k++) {
+                buf[k] = (k & 1) ? 0xFFF : 0;
+            }
+            dac.write(buf);
+        }
+
+        if (!ok) {
+            Serial.print(configs[i].name);
+            Serial.println(": failed to start the streams!");
+            continue;
+        }
+
+        float busy = copy_throughput(adcs, AN_ARRAY_SIZE(adcs));
+        Serial.print(configs[i].name);
+        Serial.print(": ");
+        Serial.print(busy);
+        Serial.print("MB/s, ");
+        Serial.print(100.0f * (idle - busy) / idle);
+        Serial.println("% lower than idle");
+
+        for (size_t j=0; j<AN_ARRAY_SIZE(adcs); j++) {
+            adcs[j].stop();
+        }
+        dac.stop();
+    }
+}
+
+void loop() {
+}
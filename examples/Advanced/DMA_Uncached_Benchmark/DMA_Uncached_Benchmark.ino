@@ -0,0 +1,86 @@
+// This example compares ADC sample buffers in cacheable and non-cacheable memory.
+// With cacheable memory, the DMA interrupt invalidates every buffer before it's
+// released; with non-cacheable memory, this is skipped, but reading the samples
+// from the CPU is slower. The example measures both sides: the CPU time left to
+// the main loop while the ADC runs, and the time it takes to sum each buffer.
+#include <Arduino_AdvancedAnalog.h>
+
+#define SAMPLE_RATE (1000000)
+#define N_SAMPLES   (4096)
+#define N_BUFFERS   (4)
+
+struct {
+    const char *name;
+    uint32_t memory;
+} configs[] = {
+    { "Cached", AN_DMA_MEM_CACHED },
+    { "Uncached", AN_DMA_MEM_UNCACHED },
+};
+
+// Counts loop iterations for one second, releasing the buffers as they come.
+uint32_t idle_loops(AdvancedADC *adc) {
+    uint32_t n_loops = 0;
+    uint32_t start = millis();
+    while (millis() - start < 1000) {
+        if (adc && adc->available()) {
+            adc->read().release();
+        }
+        n_loops++;
+    }
+    return n_loops;
+}
+
+// Returns the average time in microseconds it takes to sum a buffer.
+float sum_time(AdvancedADC &adc, size_t n_buffers) {
+    uint32_t total = 0;
+    volatile uint32_t sum = 0;
+    for (size_t i=0; i<n_buffers; i++) {
+        while (!adc.available()) {
+
+        }
+        SampleBuffer buf = adc.read();
+        uint32_t start = micros();
+        for (size_t k=0; k<buf.size(); k++) {
+            sum += buf[k];
+        }
+        total += micros() - start;
+        buf.release();
+    }
+    return (float) total / n_buffers;
+}
+
+void setup() {
+    Serial.begin(9600);
+    while (!Serial) {
+
+    }
+
+    uint32_t idle = idle_loops(nullptr);
+    Serial.print("Idle: ");
+    Serial.print(idle);
+    Serial.println(" loops/s");
+
+    for (size_t i=0; i<AN_ARRAY_SIZE(configs); i++) {
+        AdvancedADC adc(A0);
+        if (!adc.dma_memory(configs[i].memory) ||
+            !adc.begin(AN_RESOLUTION_12, SAMPLE_RATE, N_SAMPLES, N_BUFFERS)) {
+            Serial.print(configs[i].name);
+            Serial.println(": failed to start the ADC!");
+            continue;
+        }
+
+        uint32_t busy = idle_loops(&adc);
+        Serial.print(configs[i].name);
+        Serial.print(": ");
+        Serial.print(busy);
+        Serial.print(" loops/s (");
+        Serial.print(100.0f * (idle - busy) / idle);
+        Serial.print("% lower than idle), ");
+        Serial.print(sum_time(adc, 64));
+        Serial.println("us to sum a buffer");
+        adc.stop();
+    }
+}
+
+void loop() {
+}
@@ -36,7 +36,7 @@ void loop() {
         // Write data to buffer.
         for (int i=0; i<dacbuf.size(); i++) {
             // Average the 2 samples, map to positive and down scale to 12-bit. 
-            // Note that I2S always captures 2 channels.
+            // Note that I2S captures 2 channels by default.
             dacbuf[i] = ((uint32_t) (SAMPLE_AVERAGE(i2sbuf[(i * 2)], i2sbuf[(i * 2) + 1]) + 32768)) >> 4;
         }
 
@@ -0,0 +1,54 @@
+// This example demonstrates I2S in full-duplex process mode. Instead of queuing buffers,
+// the process function is called from the DMA interrupt with every input buffer that was
+// just captured, and the output buffer to fill. The output is always exactly one buffer
+// behind the input, which makes this mode suitable for low-latency effects.
+
+#include <Arduino_AdvancedAnalog.h>
+
+#define N_SAMPLES   (64)
+
+// WS, CK, SDI, SDO, MCK
+AdvancedI2S i2s(PG_10, PG_11, PG_9, PB_5, PC_4);
+
+volatile uint32_t n_calls = 0;
+
+void process(SampleBuffer rx, SampleBuffer tx) {
+    // NOTE: This function is called from an interrupt, and it must return before
+    // the next buffer is captured (N_SAMPLES / sample rate).
+    int16_t *in = (int16_t *) rx.data();
+    int16_t *out = (int16_t *) tx.data();
+    for (size_t i=0; i<rx.size(); i++) {
+        // Apply a gain of 0.5.
+        out[i] = in[i] / 2;
+    }
+    n_calls++;
+}
+
+void setup() {
+    Serial.begin(9600);
+    while (!Serial) {
+
+    }
+
+    // Process function, sample rate, number of samples per channel.
+    if (!i2s.begin(process, 48000, N_SAMPLES)) {
+        Serial.println("Failed to start I2S");
+        while (1);
+    }
+
+    // Both directions are double-buffered: a sample waits up to one buffer period to be
+    // captured, and is played one buffer period after it's processed.
+    float period = N_SAMPLES * 1000000.0f / i2s.frequency();
+    Serial.print("Buffer period: ");
+    Serial.print(period);
+    Serial.println(" us");
+    Serial.print("Latency: ");
+    Serial.print(2 * period);
+    Serial.println(" us");
+}
+
+void loop() {
+    Serial.print("Buffers processed: ");
+    Serial.println(n_calls);
+    delay(1000);
+}
@@ -0,0 +1,78 @@
+// This example captures a PDM microphone, decimates the bitstream to 16-bit PCM,
+// and prints the peak level of every buffer. Before starting the capture, it
+// benchmarks the decimator and prints the CPU load of a single channel.
+
+#include <Arduino_AdvancedAnalog.h>
+
+#define SAMPLE_RATE (48000)
+#define N_SAMPLES   (256)
+#define N_BLOCKS    (100)
+
+// CLK, DATA
+AdvancedPDM pdm(PG_11, PG_9);
+
+void benchmark() {
+    PDMDecimator decimator;
+    static uint32_t bits[N_SAMPLES * AN_PDM_DECIMATION / 32];
+    static int16_t pcm[N_SAMPLES];
+
+    // Generate a 1KHz tone with a first-order sigma-delta modulator.
+    int32_t acc = 0;
+    for (size_t i=0; i<AN_ARRAY_SIZE(bits); i++) {
+        for (size_t b=0; b<32; b++) {
+            float t = (i * 32 + b) / (float) (SAMPLE_RATE * AN_PDM_DECIMATION);
+            acc += (int32_t) (16384.0f * sin(2.0f * PI * 1000.0f * t));
+            uint32_t bit = acc >= 0;
+            acc -= bit ? 32767 : -32767;
+            bits[i] = (bits[i] << 1) | bit;
+        }
+    }
+
+    decimator.begin();
+    uint32_t start = micros();
+    for (size_t i=0; i<N_BLOCKS; i++) {
+        decimator.decimate(bits, AN_ARRAY_SIZE(bits), pcm);
+    }
+    float us = (micros() - start) / (float) N_BLOCKS;
+    float block_us = N_SAMPLES * 1000000.0f / SAMPLE_RATE;
+
+    Serial.print("Decimation: ");
+    Serial.print(us);
+    Serial.print("us per ");
+    Serial.print(N_SAMPLES);
+    Serial.print(" samples, CPU load per channel: ");
+    Serial.print(us * 100.0f / block_us);
+    Serial.println("%");
+}
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) {
+
+    }
+
+    benchmark();
+
+    // Sample rate, number of samples per buffer, queue depth, gain.
+    if (!pdm.begin(SAMPLE_RATE, N_SAMPLES, 8, 4.0f)) {
+        Serial.println("Failed to start PDM");
+        while (1);
+    }
+}
+
+void loop() {
+    if (pdm.available()) {
+        SampleBuffer buf = pdm.read();
+        int16_t *data = (int16_t *) buf.data();
+        int32_t peak = 0;
+
+        for (size_t i=0; i<buf.size(); i++) {
+            int32_t s = abs(data[i]);
+            if (s > peak) {
+                peak = s;
+            }
+        }
+        buf.release();
+        Serial.println(peak);
+    }
+}
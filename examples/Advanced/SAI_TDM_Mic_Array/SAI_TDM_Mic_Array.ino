@@ -0,0 +1,48 @@
+// This example captures 8 TDM microphones over a single SAI link, and prints
+// the peak level of every microphone. All slots are interleaved in each buffer.
+
+#include <Arduino_AdvancedAnalog.h>
+
+#define N_SLOTS     (8)
+#define N_SAMPLES   (256)
+
+// FS, SCK, SD, MCK
+AdvancedSAI32 sai(PE_4, PE_5, PE_6, NC);
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) {
+
+    }
+
+    // Mode, sample rate, number of samples per slot, queue depth, number of slots, resolution.
+    // The 24-bit microphone samples are received left-aligned in 32-bit slots.
+    if (!sai.begin(AN_I2S_MODE_IN, 48000, N_SAMPLES, 16, N_SLOTS, AN_RESOLUTION_32)) {
+        Serial.println("Failed to start SAI");
+        while (1);
+    }
+}
+
+void loop() {
+    if (sai.available()) {
+        SampleBuffer32 buf = sai.read();
+        int32_t *data = (int32_t *) buf.data();
+        int32_t peak[N_SLOTS] = { 0 };
+
+        // Samples are interleaved: mic0, mic1, ... mic7, mic0, mic1 ...
+        for (size_t i=0; i<N_SAMPLES; i++) {
+            for (size_t c=0; c<N_SLOTS; c++) {
+                int32_t s = abs(data[i * N_SLOTS + c] >> 8);
+                if (s > peak[c]) {
+                    peak[c] = s;
+                }
+            }
+        }
+        buf.release();
+
+        for (size_t c=0; c<N_SLOTS; c++) {
+            Serial.print(peak[c]);
+            Serial.print((c == N_SLOTS - 1) ? "\n" : " ");
+        }
+    }
+}
@@ -0,0 +1,84 @@
+// This example measures the cost of decoding IMA ADPCM WAV files, and compares
+// it with reading the same audio as 16-bit PCM. ADPCM files are a quarter of
+// the size, so a quarter of the bytes are read from storage, at the cost of
+// decoding each sample.
+// To run this sketch, rename 'USB_DRIVE' to the name of your USB stick drive,
+// and copy the provided audio sample to the drive, along with an ADPCM copy:
+//   ffmpeg -i AUDIO_SAMPLE.wav -c:a adpcm_ima_wav AUDIO_ADPCM.wav
+#include <Arduino_AdvancedAnalog.h>
+#include <Arduino_USBHostMbed5.h>
+#include <FATFileSystem.h>
+
+USBHostMSD msd;
+mbed::FATFileSystem usb("USB_DRIVE");
+
+#define N_SAMPLES   (256)
+#define N_BUFFERS   (8)
+
+void benchmark(const char *name, const char *path) {
+    WavReader wav;
+    if (!wav.begin(path, N_SAMPLES, N_BUFFERS, false)) {
+        Serial.print("Error opening ");
+        Serial.println(path);
+        return;
+    }
+
+    FILE *file = fopen(path, "rb");
+    fseek(file, 0, SEEK_END);
+    size_t file_size = ftell(file);
+    fclose(file);
+
+    size_t n_samples = 0;
+    uint32_t start = micros();
+    while (wav.available()) {
+        SampleBuffer buf = wav.read();
+        n_samples += buf.size();
+        buf.release();
+    }
+    uint32_t us = micros() - start;
+
+    // The time per sample includes storage access; the CPU load is the share of
+    // real time spent reading and decoding while playing at the file's rate.
+    float seconds = (float) n_samples / (wav.sample_rate() * wav.channels());
+    Serial.print(name);
+    Serial.print(": ");
+    Serial.print(file_size / 1024);
+    Serial.print("KB read, ");
+    Serial.print((us * 1000.0f) / n_samples);
+    Serial.print("ns per sample, ");
+    Serial.print(file_size / seconds / 1024.0f);
+    Serial.print("KB/s needed for playback, ");
+    Serial.print((us / 10000.0f) / seconds);
+    Serial.println("% CPU load");
+    wav.stop();
+}
+
+void setup() {
+    Serial.begin(9600);
+    while (!Serial) {
+
+    }
+
+    // Enable power for HOST USB connector.
+    pinMode(PA_15, OUTPUT);
+    digitalWrite(PA_15, HIGH);
+
+    Serial.println("Please connect a USB stick to the USB host port...");
+    while (!msd.connect()) {
+        delay(100);
+    }
+
+    Serial.println("Mounting USB device...");
+    int const rc_mount = usb.mount(&msd);
+    if (rc_mount) {
+        Serial.print("Error mounting USB device ");
+        Serial.println(rc_mount);
+        while (1);
+    }
+
+    benchmark("PCM", "/USB_DRIVE/AUDIO_SAMPLE.wav");
+    benchmark("ADPCM", "/USB_DRIVE/AUDIO_ADPCM.wav");
+}
+
+void loop() {
+}
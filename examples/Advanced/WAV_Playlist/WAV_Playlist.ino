@@ -0,0 +1,80 @@
+// This example shows how to play several WAV files without gaps between them.
+// An intro is played once, then a music loop is queued and played in a loop,
+// and an outro is queued when the button is pressed, so it starts right at the
+// end of the current loop.
+// To run this sketch, rename 'USB_DRIVE' to the name of your USB stick drive,
+// and copy the three audio files to the drive. The files must have the same
+// sample rate.
+#include <Arduino_AdvancedAnalog.h>
+#include <Arduino_USBHostMbed5.h>
+#include <FATFileSystem.h>
+
+USBHostMSD msd;
+mbed::FATFileSystem usb("USB_DRIVE");
+
+WavReader wav;
+AdvancedDAC dac1(A12);
+
+#define N_SAMPLES   (512)
+#define BUTTON_PIN  (D2)
+
+void setup() {
+    Serial.begin(9600);
+    while (!Serial) {
+
+    }
+
+    pinMode(BUTTON_PIN, INPUT_PULLUP);
+
+    // Enable power for HOST USB connector.
+    pinMode(PA_15, OUTPUT);
+    digitalWrite(PA_15, HIGH);
+
+    Serial.println("Please connect a USB stick to the USB host port...");
+    while (!msd.connect()) {
+        delay(100);
+    }
+
+    Serial.println("Mounting USB device...");
+    int const rc_mount = usb.mount(&msd);
+    if (rc_mount) {
+        Serial.print("Error mounting USB device ");
+        Serial.println(rc_mount);
+        while (1);
+    }
+
+    // Mix all channels down to a single 12-bit DAC channel, and read ahead.
+    wav.output(AN_RESOLUTION_12, false, 1);
+    if (!wav.begin("/USB_DRIVE/INTRO.wav", N_SAMPLES, 16, false, true)) {
+        Serial.println("Error opening audio file");
+        while (1);
+    }
+
+    // The loop is opened now, and starts right after the intro.
+    if (!wav.queue("/USB_DRIVE/LOOP.wav", true)) {
+        Serial.println("Error queuing audio file");
+        while (1);
+    }
+
+    if (!dac1.begin(AN_RESOLUTION_12, wav.sample_rate(), N_SAMPLES, 32)) {
+        Serial.println("Failed to start DAC1 !");
+        while (1);
+    }
+}
+
+void loop() {
+    static bool outro = false;
+
+    if (!outro && digitalRead(BUTTON_PIN) == LOW && !wav.queued()) {
+        // The outro starts at the end of the current loop.
+        outro = wav.queue("/USB_DRIVE/OUTRO.wav");
+    }
+
+    if (dac1.available() && wav.available()) {
+        SampleBuffer dacbuf = dac1.dequeue();
+        SampleBuffer pcmbuf = wav.read();
+        memcpy(dacbuf.data(), pcmbuf.data(), pcmbuf.bytes());
+        pcmbuf.release();
+        dac1.write(dacbuf);
+    }
+}
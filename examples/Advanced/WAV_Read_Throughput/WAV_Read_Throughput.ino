@@ -0,0 +1,97 @@
+// This example measures the sustained read throughput of WavReader, and compares
+// it with reading the same file with one stdio fread() per sample buffer.
+// To run this sketch, rename 'USB_DRIVE' to the name of your USB
+// stick drive, and copy the provided audio sample to the drive.
+#include <Arduino_AdvancedAnalog.h>
+#include <Arduino_USBHostMbed5.h>
+#include <FATFileSystem.h>
+
+USBHostMSD msd;
+mbed::FATFileSystem usb("USB_DRIVE");
+
+#define WAV_PATH    "/USB_DRIVE/AUDIO_SAMPLE.wav"
+#define N_SAMPLES   (256)
+#define N_BUFFERS   (8)
+
+void print_throughput(const char *name, size_t n_bytes, uint32_t us) {
+    Serial.print(name);
+    Serial.print(": ");
+    Serial.print(n_bytes / 1024);
+    Serial.print("KB in ");
+    Serial.print(us / 1000);
+    Serial.print("ms, ");
+    Serial.print((n_bytes / 1024.0f) / (us / 1000000.0f));
+    Serial.println("KB/s");
+}
+
+void benchmark_stdio() {
+    static Sample buf[N_SAMPLES * 2];
+    FILE *file = fopen(WAV_PATH, "rb");
+    if (file == nullptr) {
+        Serial.println("Error opening audio file");
+        return;
+    }
+
+    size_t n_bytes = 0;
+    uint32_t start = micros();
+    fseek(file, 44, SEEK_SET);
+    while (true) {
+        size_t n = fread(buf, sizeof(Sample), N_SAMPLES * 2, file);
+        if (n == 0) {
+            break;
+        }
+        n_bytes += n * sizeof(Sample);
+    }
+    uint32_t us = micros() - start;
+    fclose(file);
+    print_throughput("fread()", n_bytes, us);
+}
+
+void benchmark_wav() {
+    WavReader wav;
+    if (!wav.begin(WAV_PATH, N_SAMPLES, N_BUFFERS, false)) {
+        Serial.println("Error opening audio file");
+        return;
+    }
+
+    size_t n_bytes = 0;
+    uint32_t start = micros();
+    while (wav.available()) {
+        SampleBuffer buf = wav.read();
+        n_bytes += buf.bytes();
+        buf.release();
+    }
+    uint32_t us = micros() - start;
+    wav.stop();
+    print_throughput("WavReader", n_bytes, us);
+}
+
+void setup() {
+    Serial.begin(9600);
+    while (!Serial) {
+
+    }
+
+    // Enable power for HOST USB connector.
+    pinMode(PA_15, OUTPUT);
+    digitalWrite(PA_15, HIGH);
+
+    Serial.println("Please connect a USB stick to the USB host port...");
+    while (!msd.connect()) {
+        delay(100);
+    }
+
+    Serial.println("Mounting USB device...");
+    int const rc_mount = usb.mount(&msd);
+    if (rc_mount) {
+        Serial.print("Error mounting USB device ");
+        Serial.println(rc_mount);
+        while (1);
+    }
+
+    benchmark_stdio();
+    benchmark_wav();
+}
+
+void loop() {
+}
@@ -27,44 +27,28 @@
 struct adc_descr_t {
     ADC_HandleTypeDef adc;
     DMA_HandleTypeDef dma;
-    IRQn_Type dma_irqn;
     TIM_HandleTypeDef tim;
     uint32_t  tim_trig;
     DMAPool<Sample> *pool;
     DMABuffer<Sample> *dmabuf[2];
+    bool uncached;
 };
 
 static uint32_t adc_pin_alt[3] = {0, ALT0, ALT1};
 
 static adc_descr_t adc_descr_all[3] = {
-    {{ADC1}, {DMA1_Stream1, {DMA_REQUEST_ADC1}}, DMA1_Stream1_IRQn, {TIM1}, ADC_EXTERNALTRIG_T1_TRGO,
-        nullptr, {nullptr, nullptr}},
-    {{ADC2}, {DMA1_Stream2, {DMA_REQUEST_ADC2}}, DMA1_Stream2_IRQn, {TIM2}, ADC_EXTERNALTRIG_T2_TRGO,
-        nullptr, {nullptr, nullptr}},
-    {{ADC3}, {DMA1_Stream3, {DMA_REQUEST_ADC3}}, DMA1_Stream3_IRQn, {TIM3}, ADC_EXTERNALTRIG_T3_TRGO,
-        nullptr, {nullptr, nullptr}},
+    {{ADC1}, {nullptr, {DMA_REQUEST_ADC1}}, {TIM1}, ADC_EXTERNALTRIG_T1_TRGO,
+        nullptr, {nullptr, nullptr}, false},
+    {{ADC2}, {nullptr, {DMA_REQUEST_ADC2}}, {TIM2}, ADC_EXTERNALTRIG_T2_TRGO,
+        nullptr, {nullptr, nullptr}, false},
+    {{ADC3}, {nullptr, {DMA_REQUEST_ADC3}}, {TIM3}, ADC_EXTERNALTRIG_T3_TRGO,
+        nullptr, {nullptr, nullptr}, false},
 };
 
 static uint32_t ADC_RES_LUT[] = {
     ADC_RESOLUTION_8B, ADC_RESOLUTION_10B, ADC_RESOLUTION_12B, ADC_RESOLUTION_14B, ADC_RESOLUTION_16B,
 };
 
-extern "C" {
-
-void DMA1_Stream1_IRQHandler() {
-    HAL_DMA_IRQHandler(adc_descr_all[0].adc.DMA_Handle);
-}
-
-void DMA1_Stream2_IRQHandler() {
-    HAL_DMA_IRQHandler(adc_descr_all[1].adc.DMA_Handle);
-}
-
-void DMA1_Stream3_IRQHandler() {
-    HAL_DMA_IRQHandler(adc_descr_all[2].adc.DMA_Handle);
-}
-
-} // extern C
-
 static adc_descr_t *adc_descr_get(ADC_TypeDef *adc) {
     if (adc == ADC1) {
         return &adc_descr_all[0];
@@ -90,9 +74,10 @@ static void dac_descr_deinit(adc_descr_t *descr, bool dealloc_pool) {
 
         if (dealloc_pool) {
             if (descr->pool) {
-                delete descr->pool;
+                hal_dma_pool_delete(descr->pool);
             }
             descr->pool = nullptr;
+            hal_dma_free(&descr->dma);
         }
     }
 }
@@ -138,6 +123,11 @@ int AdvancedADC::begin(uint32_t resolution, uint32_t sample_rate, size_t n_sampl
         return 0;
     }
 
+    // The buffers must hold a whole number of DMA bursts.
+    if (hal_dma_check_burst(burst, fifo, sizeof(Sample), n_samples * n_channels * sizeof(Sample)) < 0) {
+        return 0;
+    }
+
     // Clear ALTx pin.
     for (size_t i=0; i<n_channels; i++) {
         adc_pins[i] =  (PinName) (adc_pins[i] & ~(ADC_PIN_ALT_MASK));
@@ -200,38 +190,57 @@ int AdvancedADC::begin(uint32_t resolution, uint32_t sample_rate, size_t n_sampl
     }
 
     // Allocate DMA buffer pool.
-    descr->pool = new DMAPool<Sample>(n_samples, n_channels, n_buffers);
+    hal_dma_arena_t mem = {(uint8_t *) arena, arena_size};
+    descr->pool = hal_dma_pool_new<Sample>(n_samples, n_channels, n_buffers, memory, &mem);
     if (descr->pool == nullptr) {
         return 0;
     }
+    descr->uncached = (memory == AN_DMA_MEM_UNCACHED);
 
     // Allocate the two DMA buffers used for double buffering.
     descr->dmabuf[0] = descr->pool->alloc(DMA_BUFFER_WRITE);
     descr->dmabuf[1] = descr->pool->alloc(DMA_BUFFER_WRITE);
 
-    // Init and config DMA.
-    if (hal_dma_config(&descr->dma, descr->dma_irqn, DMA_PERIPH_TO_MEMORY) < 0) {
+    // Init and config DMA. From here on, failures free the pool and the DMA stream,
+    // so the descriptor can be used again.
+    if (hal_dma_config(&descr->dma, DMA_PERIPH_TO_MEMORY, sizeof(Sample), burst, fifo, priority) < 0) {
+        dac_descr_deinit(descr, true);
+        descr = nullptr;
         return 0;
     }
 
     // Init and config ADC.
     if (hal_adc_config(&descr->adc, ADC_RES_LUT[resolution], descr->tim_trig, adc_pins, n_channels, sample_time) < 0) {
+        dac_descr_deinit(descr, true);
+        descr = nullptr;
+        return 0;
+    }
+
+    // The timer of a synchronised ADC is started by its sync group. It's configured
+    // before the ADC is started, so the timer's init doesn't trigger a conversion.
+    if (sync_hold && hal_tim_config(&descr->tim, sample_rate) < 0) {
+        dac_descr_deinit(descr, true);
+        descr = nullptr;
         return 0;
     }
 
     // Link DMA handle to ADC handle, and start the ADC.
     __HAL_LINKDMA(&descr->adc, DMA_Handle, descr->dma);
     if (HAL_ADC_Start_DMA(&descr->adc, (uint32_t *) descr->dmabuf[0]->data(), descr->dmabuf[0]->size()) != HAL_OK) {
+        dac_descr_deinit(descr, true);
+        descr = nullptr;
         return 0;
     }
 
     // Re/enable DMA double buffer mode.
-    HAL_NVIC_DisableIRQ(descr->dma_irqn);
+    HAL_NVIC_DisableIRQ(hal_dma_irqn(&descr->dma));
     hal_dma_enable_dbm(&descr->dma, descr->dmabuf[0]->data(), descr->dmabuf[1]->data());
-    HAL_NVIC_EnableIRQ(descr->dma_irqn);
+    HAL_NVIC_EnableIRQ(hal_dma_irqn(&descr->dma));
 
-    if (start) {
-        return this->start(sample_rate);
+    if (start && !sync_hold && !this->start(sample_rate)) {
+        dac_descr_deinit(descr, true);
+        descr = nullptr;
+        return 0;
     }
 
     return 1;
@@ -261,6 +270,48 @@ void AdvancedADC::clear() {
     }
 }
 
+int AdvancedADC::dma_burst(uint32_t burst, uint32_t fifo) {
+    // Must be called before begin().
+    if ((descr && descr->pool) || hal_dma_check_burst(burst, fifo, sizeof(Sample), 0) < 0) {
+        return 0;
+    }
+    this->burst = burst;
+    this->fifo = fifo;
+    return 1;
+}
+
+int AdvancedADC::dma_memory(uint32_t memory, void *arena, size_t size) {
+    // Must be called before begin().
+    if ((descr && descr->pool) || memory > AN_DMA_MEM_UNCACHED ||
+       (memory == AN_DMA_MEM_UNCACHED && arena == nullptr && hal_dma_mem_check() < 0)) {
+        return 0;
+    }
+    this->memory = memory;
+    this->arena = arena;
+    this->arena_size = size;
+    return 1;
+}
+
+int AdvancedADC::irq_priority(uint32_t priority) {
+    if (priority > AN_IRQ_PRIORITY_LOWEST) {
+        return 0;
+    }
+    this->priority = priority;
+    // If the ADC is running, the new priority takes effect immediately.
+    if (descr && descr->pool) {
+        hal_dma_set_priority(&descr->dma, priority);
+    }
+    return 1;
+}
+
+TIM_HandleTypeDef *AdvancedADC::sync_timer() {
+    // The ADC must be configured, and its timer must not be running.
+    if (descr == nullptr || descr->pool == nullptr || (descr->tim.Instance->CR1 & TIM_CR1_CEN)) {
+        return nullptr;
+    }
+    return &descr->tim;
+}
+
 size_t AdvancedADC::channels() {
     return n_channels;
 }
@@ -324,7 +375,9 @@ void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *adc) {
 
     if (descr->pool->writable()) {
         // Make sure any cached data is discarded.
-        descr->dmabuf[ct]->invalidate();
+        if (!descr->uncached) {
+            descr->dmabuf[ct]->invalidate();
+        }
         // Move current DMA buffer to ready queue.
         descr->dmabuf[ct]->release();
         // Allocate a new free buffer.
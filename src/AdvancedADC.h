@@ -40,10 +40,21 @@ class AdvancedADC {
         size_t n_channels;
         adc_descr_t *descr;
         PinName adc_pins[AN_MAX_ADC_CHANNELS];
+        uint32_t burst;
+        uint32_t fifo;
+        uint32_t memory;
+        void *arena;
+        size_t arena_size;
+        uint32_t priority;
+        bool sync_hold;
+        friend class AdvancedSync;
+        TIM_HandleTypeDef *sync_timer();
 
     public:
         template <typename ... T>
-        AdvancedADC(pin_size_t p0, T ... args): n_channels(0), descr(nullptr) {
+        AdvancedADC(pin_size_t p0, T ... args): n_channels(0), descr(nullptr),
+            burst(AN_DMA_BURST_SINGLE), fifo(AN_DMA_FIFO_FULL), memory(AN_DMA_MEM_CACHED),
+            arena(nullptr), arena_size(0), priority(AN_IRQ_PRIORITY_HIGHEST), sync_hold(false) {
             static_assert(sizeof ...(args) < AN_MAX_ADC_CHANNELS,
                     "A maximum of 16 channels can be sampled successively.");
 
@@ -51,7 +62,9 @@ class AdvancedADC {
                 adc_pins[n_channels++] = analogPinToPinName(p);
             }
         }
-        AdvancedADC(): n_channels(0), descr(nullptr) {
+        AdvancedADC(): n_channels(0), descr(nullptr), burst(AN_DMA_BURST_SINGLE), fifo(AN_DMA_FIFO_FULL),
+            memory(AN_DMA_MEM_CACHED), arena(nullptr), arena_size(0), priority(AN_IRQ_PRIORITY_HIGHEST),
+            sync_hold(false) {
         }
         ~AdvancedADC();
         int id();
@@ -72,6 +85,9 @@ class AdvancedADC {
             n_channels = n_pins;
             return begin(resolution, sample_rate, n_samples, n_buffers, start, sample_time);
         }
+        int dma_burst(uint32_t burst, uint32_t fifo=AN_DMA_FIFO_FULL);
+        int dma_memory(uint32_t memory, void *arena=nullptr, size_t size=0);
+        int irq_priority(uint32_t priority);
         int start(uint32_t sample_rate);
         int stop();
         void clear();
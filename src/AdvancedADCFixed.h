@@ -0,0 +1,138 @@
+/*
+  This file is part of the Arduino_AdvancedAnalog library.
+  Copyright (c) 2024 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_ADC_FIXED_H__
+#define __ADVANCED_ADC_FIXED_H__
+
+#include "AdvancedADC.h"
+
+// Sample conversion used by the deinterleave helpers: floating-point outputs are
+// normalized to [0, 1], all other types get the raw ADC value.
+static inline void adc_fixed_convert(float &out, Sample in, float scale) {
+    out = in * scale;
+}
+
+template <typename T>
+static inline void adc_fixed_convert(T &out, Sample in, float scale) {
+    out = (T) in;
+}
+
+// ADC capture with a fixed configuration. The channel count and the buffer geometry
+// are template parameters, so the sample buffers are allocated statically with the
+// object, and the helpers below are specialised for the configuration. T is the
+// sample type the helpers convert to.
+template <size_t N_CHANNELS, size_t N_SAMPLES, size_t N_BUFFERS, typename T=Sample>
+class AdvancedADCFixed {
+    static_assert(N_CHANNELS > 0 && N_CHANNELS <= AN_MAX_ADC_CHANNELS,
+            "A maximum of 16 channels can be sampled successively.");
+    static_assert(N_SAMPLES > 0 && N_BUFFERS >= 2,
+            "At least two buffers of one or more samples are needed for double buffering.");
+
+    private:
+        AdvancedADC adc;
+        float scale;
+        friend class AdvancedSync;
+        // NOTE: Objects allocated with new are only 8-byte aligned, so the arena has room
+        // to be realigned to the cache line size.
+        alignas(__SCB_DCACHE_LINE_SIZE) uint8_t arena[AN_DMA_ARENA_SIZE(Sample, N_SAMPLES, N_CHANNELS, N_BUFFERS) +
+                                                      __SCB_DCACHE_LINE_SIZE - 1];
+
+    public:
+        template <typename ... P>
+        AdvancedADCFixed(pin_size_t p0, P ... pins): adc(p0, ((pin_size_t) pins)...), scale(0.0f) {
+            static_assert(sizeof ...(pins) + 1 == N_CHANNELS,
+                    "The number of pins must match the number of channels.");
+        }
+
+        static constexpr size_t channels() {
+            return N_CHANNELS;
+        }
+
+        static constexpr size_t samples() {
+            return N_SAMPLES;
+        }
+
+        int begin(uint32_t resolution, uint32_t sample_rate, bool start=true,
+                  adc_sample_time_t sample_time=AN_ADC_SAMPLETIME_8_5) {
+            if (resolution > AN_RESOLUTION_16 || !adc.dma_memory(AN_DMA_MEM_CACHED, arena, sizeof(arena))) {
+                return 0;
+            }
+            scale = 1.0f / ((1U << (8 + resolution * 2)) - 1);
+            return adc.begin(resolution, sample_rate, N_SAMPLES, N_BUFFERS, start, sample_time);
+        }
+
+        int dma_burst(uint32_t burst, uint32_t fifo=AN_DMA_FIFO_FULL) {
+            return adc.dma_burst(burst, fifo);
+        }
+
+        int irq_priority(uint32_t priority) {
+            return adc.irq_priority(priority);
+        }
+
+        int start(uint32_t sample_rate) {
+            return adc.start(sample_rate);
+        }
+
+        int stop() {
+            return adc.stop();
+        }
+
+        void clear() {
+            adc.clear();
+        }
+
+        bool available() {
+            return adc.available();
+        }
+
+        SampleBuffer read() {
+            return adc.read();
+        }
+
+        // Copies one channel of a buffer to out, which holds N_SAMPLES samples.
+        void deinterleave(SampleBuffer buf, size_t channel, T *out) {
+            const Sample *in = buf.data() + channel;
+            for (size_t i=0; i<N_SAMPLES; i++) {
+                adc_fixed_convert(out[i], in[i * N_CHANNELS], scale);
+            }
+        }
+
+        // Copies all channels of a buffer to out.
+        void deinterleave(SampleBuffer buf, T (&out)[N_CHANNELS][N_SAMPLES]) {
+            const Sample *in = buf.data();
+            for (size_t i=0; i<N_SAMPLES; i++) {
+                for (size_t c=0; c<N_CHANNELS; c++) {
+                    adc_fixed_convert(out[c][i], in[i * N_CHANNELS + c], scale);
+                }
+            }
+        }
+
+        // Reads the next buffer into out, and releases it. Returns 0 if no buffer is ready.
+        int read(T (&out)[N_CHANNELS][N_SAMPLES]) {
+            if (!adc.available()) {
+                return 0;
+            }
+            SampleBuffer buf = adc.read();
+            deinterleave(buf, out);
+            buf.release();
+            return 1;
+        }
+};
+
+#endif // __ADVANCED_ADC_FIXED_H__
@@ -30,10 +30,71 @@ enum {
     AN_RESOLUTION_12 = 2U,
     AN_RESOLUTION_14 = 3U,
     AN_RESOLUTION_16 = 4U,
+    AN_RESOLUTION_24 = 5U,
+    AN_RESOLUTION_32 = 6U,
 };
 
+// DMA memory burst length, in data items. Peripheral transfers are always single.
+enum {
+    AN_DMA_BURST_SINGLE = 0U,
+    AN_DMA_BURST_INC4   = 1U,
+    AN_DMA_BURST_INC8   = 2U,
+    AN_DMA_BURST_INC16  = 3U,
+};
+
+// DMA FIFO threshold, in quarters of the 16-byte FIFO.
+enum {
+    AN_DMA_FIFO_1_4     = 0U,
+    AN_DMA_FIFO_1_2     = 1U,
+    AN_DMA_FIFO_3_4     = 2U,
+    AN_DMA_FIFO_FULL    = 3U,
+};
+
+// DMA interrupt priority, from the highest (the default) to the lowest.
+#define AN_IRQ_PRIORITY_HIGHEST (0U)
+#define AN_IRQ_PRIORITY_LOWEST  ((1U << __NVIC_PRIO_BITS) - 1)
+
+// DMA buffer memory: cacheable heap memory (the default), or a non-cacheable SRAM
+// region, which doesn't need cache maintenance.
+enum {
+    AN_DMA_MEM_CACHED   = 0U,
+    AN_DMA_MEM_UNCACHED = 1U,
+};
+
+// Non-cacheable DMA buffer region, configured with the MPU on first use. The base must
+// be aligned to the size, which must be a power of 2. The default is D2 SRAM2. D2 SRAM
+// is the M4 core's RAM, so a region in D2 SRAM can't be used once the M4 has booted.
+#ifndef AN_DMA_NC_BASE
+#define AN_DMA_NC_BASE          (0x30020000UL)
+#endif
+#ifndef AN_DMA_NC_SIZE
+#define AN_DMA_NC_SIZE          (128 * 1024)
+#endif
+#ifndef AN_DMA_NC_BLOCKS
+#define AN_DMA_NC_BLOCKS        (16)
+#endif
+#ifndef AN_DMA_NC_MPU_REGION
+#define AN_DMA_NC_MPU_REGION    (15)
+#endif
+
+// DMA streams that can be allocated to the drivers: bit n selects DMA1 stream n, and
+// bit n + 8 selects DMA2 stream n. The library only defines the interrupt handlers of
+// these streams, so the others can be used by other libraries. The default is the
+// streams used by earlier versions of the library.
+#ifndef AN_DMA_STREAM_MASK
+#define AN_DMA_STREAM_MASK      (0x7EFEU)
+#endif
+
+// Size of the memory needed for a pool of n_buffers buffers of n_samples x n_channels
+// samples of type T, when it's carved from a caller-provided arena.
+#define AN_DMA_ARENA_SIZE(T, n_samples, n_channels, n_buffers) \
+    ((((n_samples) * (n_channels) * sizeof(T) + __SCB_DCACHE_LINE_SIZE - 1) & \
+      ~(__SCB_DCACHE_LINE_SIZE - 1)) * (n_buffers))
+
 typedef uint16_t                Sample;     // Sample type used for ADC/DAC.
 typedef DMABuffer<Sample>       &SampleBuffer;
+typedef uint32_t                Sample32;   // Sample type used for 24/32-bit I2S.
+typedef DMABuffer<Sample32>     &SampleBuffer32;
 
 #define AN_MAX_ADC_CHANNELS     (16)
 #define AN_MAX_DAC_CHANNELS     (1)
@@ -25,7 +25,6 @@ struct dac_descr_t {
     DAC_HandleTypeDef *dac;
     uint32_t  channel;
     DMA_HandleTypeDef dma;
-    IRQn_Type dma_irqn;
     TIM_HandleTypeDef tim;
     uint32_t tim_trig;
     uint32_t resolution;
@@ -33,16 +32,25 @@ struct dac_descr_t {
     DMAPool<Sample> *pool;
     DMABuffer<Sample> *dmabuf[2];
     bool loop_mode;
+    volatile uint32_t tim_freq;
+    size_t dma_size;
+    uint32_t dma_burst;
+    uint32_t burst;
+    uint32_t fifo;
+    uint32_t priority;
+    bool playing;
+    hal_dma_play_t play;
+    bool uncached;
 };
 
 // NOTE: Both DAC channel descriptors share the same DAC handle.
 static DAC_HandleTypeDef dac = {0};
 
 static dac_descr_t dac_descr_all[] = {
-    {&dac, DAC_CHANNEL_1, {DMA1_Stream4, {DMA_REQUEST_DAC1_CH1}}, DMA1_Stream4_IRQn, {TIM4},
-        DAC_TRIGGER_T4_TRGO, DAC_ALIGN_12B_R, DAC_FLAG_DMAUDR1, nullptr, {nullptr, nullptr}, false},
-    {&dac, DAC_CHANNEL_2, {DMA1_Stream5, {DMA_REQUEST_DAC1_CH2}}, DMA1_Stream5_IRQn, {TIM5},
-        DAC_TRIGGER_T5_TRGO, DAC_ALIGN_12B_R, DAC_FLAG_DMAUDR2, nullptr, {nullptr, nullptr}, false},
+    {&dac, DAC_CHANNEL_1, {nullptr, {DMA_REQUEST_DAC1_CH1}}, {TIM4},
+        DAC_TRIGGER_T4_TRGO, DAC_ALIGN_12B_R, DAC_FLAG_DMAUDR1, nullptr, {nullptr, nullptr}, false, 0},
+    {&dac, DAC_CHANNEL_2, {nullptr, {DMA_REQUEST_DAC1_CH2}}, {TIM5},
+        DAC_TRIGGER_T5_TRGO, DAC_ALIGN_12B_R, DAC_FLAG_DMAUDR2, nullptr, {nullptr, nullptr}, false, 0},
 };
 
 static uint32_t DAC_RES_LUT[] = {
@@ -53,18 +61,19 @@ static uint32_t DAC_CHAN_LUT[] = {
     DAC_CHANNEL_1, DAC_CHANNEL_2,
 };
 
-extern "C" {
-
-void DMA1_Stream4_IRQHandler() {
-    HAL_DMA_IRQHandler(&dac_descr_all[0].dma);
-}
-
-void DMA1_Stream5_IRQHandler() {
-    HAL_DMA_IRQHandler(&dac_descr_all[1].dma);
+static int dac_dma_config(dac_descr_t *descr, size_t data_size, uint32_t burst) {
+    // Playback from memory may use 8-bit or single transfers, so the DMA is only
+    // reconfigured when the transfer size or burst changes.
+    if (descr->dma_size != data_size || descr->dma_burst != burst) {
+        if (hal_dma_config(&descr->dma, DMA_MEMORY_TO_PERIPH, data_size, burst, descr->fifo, descr->priority) != 0) {
+            return 0;
+        }
+        descr->dma_size = data_size;
+        descr->dma_burst = burst;
+    }
+    return 1;
 }
 
-} // extern C
-
 static dac_descr_t *dac_descr_get(uint32_t channel) {
     if (channel == DAC_CHANNEL_1) {
         return &dac_descr_all[0];
@@ -81,6 +90,14 @@ static void dac_descr_deinit(dac_descr_t *descr, bool dealloc_pool) {
 
         __HAL_DAC_CLEAR_FLAG(descr->dac, descr->dmaudr_flag);
 
+        descr->playing = false;
+
+        // Apply any pending frequency change, so it's not lost when restarting.
+        if (descr->tim_freq) {
+            hal_tim_set_freq(&descr->tim, descr->tim_freq);
+            descr->tim_freq = 0;
+        }
+
         for (size_t i=0; i<AN_ARRAY_SIZE(descr->dmabuf); i++) {
             if (descr->dmabuf[i]) {
                 descr->dmabuf[i]->release();
@@ -90,9 +107,10 @@ static void dac_descr_deinit(dac_descr_t *descr, bool dealloc_pool) {
 
         if (dealloc_pool) {
             if (descr->pool) {
-                delete descr->pool;
+                hal_dma_pool_delete(descr->pool);
             }
             descr->pool = nullptr;
+            hal_dma_free(&descr->dma);
         } else {
             descr->pool->flush();
         }
@@ -104,14 +122,15 @@ bool AdvancedDAC::available() {
         if (__HAL_DAC_GET_FLAG(descr->dac, descr->dmaudr_flag)) {
             dac_descr_deinit(descr, false);
         }
-        return descr->pool->writable();
+        // Buffers can't be written while samples are played from memory.
+        return !descr->playing && descr->pool->writable();
     }
     return false;
 }
 
 DMABuffer<Sample> &AdvancedDAC::dequeue() {
     static DMABuffer<Sample> NULLBUF;
-    if (descr != nullptr) {
+    if (descr != nullptr && !descr->playing) {
         while (!available()) {
             __WFI();
         }
@@ -128,7 +147,9 @@ void AdvancedDAC::write(DMABuffer<Sample> &dmabuf) {
     }
 
     // Make sure any cached data is flushed.
-    dmabuf.flush();
+    if (!descr->uncached) {
+        dmabuf.flush();
+    }
     dmabuf.release();
 
     if (!descr->dmabuf[0] &&
@@ -136,19 +157,89 @@ void AdvancedDAC::write(DMABuffer<Sample> &dmabuf) {
        (!descr->loop_mode && (++buf_count % 3 == 0)))) {
         descr->dmabuf[0] = descr->pool->alloc(DMA_BUFFER_READ);
         descr->dmabuf[1] = descr->pool->alloc(DMA_BUFFER_READ);
+        dac_dma_config(descr, sizeof(Sample), descr->burst);
 
         // Start DAC DMA.
         HAL_DAC_Start_DMA(descr->dac, descr->channel,
         (uint32_t *) descr->dmabuf[0]->data(), descr->dmabuf[0]->size(), descr->resolution);
 
         // Re/enable DMA double buffer mode.
-        HAL_NVIC_DisableIRQ(descr->dma_irqn);
+        HAL_NVIC_DisableIRQ(hal_dma_irqn(&descr->dma));
         hal_dma_enable_dbm(&descr->dma, descr->dmabuf[0]->data(), descr->dmabuf[1]->data());
-        HAL_NVIC_EnableIRQ(descr->dma_irqn);
+        HAL_NVIC_EnableIRQ(hal_dma_irqn(&descr->dma));
+
+        // Start trigger timer, unless the DAC is synchronised, in which case
+        // the timer is started by its sync group.
+        if (!sync_hold) {
+            HAL_TIM_Base_Start(&descr->tim);
+        }
+    }
+}
+
+int AdvancedDAC::play_dma(const void *data, size_t size, size_t sample_size, bool loop) {
+    // The DAC must be idle. Two buffers from the pool are used as pad buffers for the
+    // end of the samples, so their size sets the size of the DMA transfers.
+    if (descr == nullptr || descr->dmabuf[0] != nullptr || data == nullptr || size < sample_size) {
+        return 0;
+    }
 
-        // Start trigger timer.
+    // The DMA can only read whole samples, so the data must be aligned to the sample size.
+    if ((uintptr_t) data % sample_size) {
+        return 0;
+    }
+
+    // Bursts must not cross a 1KB boundary, so samples that aren't aligned to the burst
+    // size are sent with single transfers.
+    uint32_t burst = descr->burst;
+    if (burst != AN_DMA_BURST_SINGLE && ((uintptr_t) data % ((2U << burst) * sample_size))) {
+        burst = AN_DMA_BURST_SINGLE;
+    }
+
+    descr->dmabuf[0] = descr->pool->alloc(DMA_BUFFER_WRITE);
+    descr->dmabuf[1] = descr->pool->alloc(DMA_BUFFER_WRITE);
+    if (descr->dmabuf[0] == nullptr || descr->dmabuf[1] == nullptr || !dac_dma_config(descr, sample_size, burst)) {
+        dac_descr_deinit(descr, false);
+        return 0;
+    }
+
+    size_t chunk = descr->dmabuf[0]->size() * sample_size;
+    uint32_t silence = (descr->resolution == DAC_ALIGN_8B_R) ? 0x80 : 0x800;
+    hal_dma_play_init(&descr->play, data, size, chunk, descr->dmabuf[0]->data(),
+                      descr->dmabuf[1]->data(), sample_size, silence, loop);
+    void *m0 = hal_dma_play_next(&descr->play, 0);
+    void *m1 = hal_dma_play_next(&descr->play, 1);
+    descr->playing = true;
+
+    // Start DAC DMA.
+    HAL_DAC_Start_DMA(descr->dac, descr->channel, (uint32_t *) m0, chunk / sample_size, descr->resolution);
+
+    // Re/enable DMA double buffer mode.
+    HAL_NVIC_DisableIRQ(hal_dma_irqn(&descr->dma));
+    hal_dma_enable_dbm(&descr->dma, m0, m1);
+    HAL_NVIC_EnableIRQ(hal_dma_irqn(&descr->dma));
+
+    // Start trigger timer, unless it's started by a sync group.
+    if (!sync_hold) {
         HAL_TIM_Base_Start(&descr->tim);
     }
+    return 1;
+}
+
+int AdvancedDAC::play(const Sample *data, size_t n_samples, bool loop) {
+    return play_dma(data, n_samples * sizeof(Sample), sizeof(Sample), loop);
+}
+
+int AdvancedDAC::play(WavImage &wav, bool loop) {
+    // WAV samples can only be played in place if they are unsigned, i.e. 8-bit mono
+    // data, which is sent with 8-bit transfers.
+    if (descr == nullptr || wav.channels() != 1 || wav.resolution() != 8 || descr->resolution != DAC_ALIGN_8B_R) {
+        return 0;
+    }
+    return play_dma(wav.data(), wav.bytes(), 1, loop);
+}
+
+bool AdvancedDAC::playing() {
+    return descr != nullptr && descr->playing;
 }
 
 int AdvancedDAC::begin(uint32_t resolution, uint32_t frequency, size_t n_samples, size_t n_buffers, bool loop) {
@@ -157,6 +248,11 @@ int AdvancedDAC::begin(uint32_t resolution, uint32_t frequency, size_t n_samples
         return 0;
     }
 
+    // The buffers must hold a whole number of DMA bursts.
+    if (hal_dma_check_burst(burst, fifo, sizeof(Sample), n_samples * n_channels * sizeof(Sample)) < 0) {
+        return 0;
+    }
+
     // Configure DAC GPIO pins.
     for (size_t i=0; i<n_channels; i++) {
         // Configure DAC GPIO pin.
@@ -170,17 +266,33 @@ int AdvancedDAC::begin(uint32_t resolution, uint32_t frequency, size_t n_samples
     }
 
     // Allocate DMA buffer pool.
-    descr->pool = new DMAPool<Sample>(n_samples, n_channels, n_buffers);
+    hal_dma_arena_t mem = {(uint8_t *) arena, arena_size};
+    descr->pool = hal_dma_pool_new<Sample>(n_samples, n_channels, n_buffers, memory, &mem);
     if (descr->pool == nullptr) {
         descr = nullptr;
         return 0;
     }
+    descr->uncached = (memory == AN_DMA_MEM_UNCACHED);
 
     descr->loop_mode = loop;
+    descr->tim_freq = 0;
     descr->resolution = DAC_RES_LUT[resolution];
 
     // Init and config DMA.
-    hal_dma_config(&descr->dma, descr->dma_irqn, DMA_MEMORY_TO_PERIPH);
+    descr->burst = burst;
+    descr->fifo = fifo;
+    descr->priority = priority;
+    if (hal_dma_config(&descr->dma, DMA_MEMORY_TO_PERIPH, sizeof(Sample), burst, fifo, priority) != 0) {
+        // No free DMA stream.
+        hal_dma_free(&descr->dma);
+        hal_dma_pool_delete(descr->pool);
+        descr->pool = nullptr;
+        descr = nullptr;
+        return 0;
+    }
+    descr->dma_size = sizeof(Sample);
+    descr->dma_burst = burst;
+    descr->playing = false;
 
     // Init and config DAC.
     hal_dac_config(descr->dac, descr->channel, descr->tim_trig);
@@ -197,6 +309,41 @@ int AdvancedDAC::begin(uint32_t resolution, uint32_t frequency, size_t n_samples
     return 1;
 }
 
+int AdvancedDAC::dma_burst(uint32_t burst, uint32_t fifo) {
+    // Must be called before begin().
+    if (descr != nullptr || hal_dma_check_burst(burst, fifo, sizeof(Sample), 0) < 0) {
+        return 0;
+    }
+    this->burst = burst;
+    this->fifo = fifo;
+    return 1;
+}
+
+int AdvancedDAC::dma_memory(uint32_t memory, void *arena, size_t size) {
+    // Must be called before begin().
+    if (descr != nullptr || memory > AN_DMA_MEM_UNCACHED ||
+       (memory == AN_DMA_MEM_UNCACHED && arena == nullptr && hal_dma_mem_check() < 0)) {
+        return 0;
+    }
+    this->memory = memory;
+    this->arena = arena;
+    this->arena_size = size;
+    return 1;
+}
+
+int AdvancedDAC::irq_priority(uint32_t priority) {
+    if (priority > AN_IRQ_PRIORITY_LOWEST) {
+        return 0;
+    }
+    this->priority = priority;
+    // If the DAC is running, the new priority takes effect immediately.
+    if (descr != nullptr) {
+        descr->priority = priority;
+        hal_dma_set_priority(&descr->dma, priority);
+    }
+    return 1;
+}
+
 int AdvancedDAC::stop() {
     if (descr != nullptr) {
         dac_descr_deinit(descr, true);
@@ -206,11 +353,28 @@ int AdvancedDAC::stop() {
 }
 
 int AdvancedDAC::frequency(uint32_t const frequency) {
-    if (descr != nullptr) {
-        // Reconfigure the trigger timer.
-        dac_descr_deinit(descr, false);
-        hal_tim_config(&descr->tim, frequency);
+    if (descr == nullptr || frequency == 0) {
+        return 0;
+    }
+
+    if (descr->dmabuf[0] == nullptr) {
+        // The DMA is not running yet, so the trigger timer can be updated directly.
+        return hal_tim_set_freq(&descr->tim, frequency) == 0;
+    }
+
+    // The DMA is running; the new frequency is applied from the DMA complete callback,
+    // so it takes effect at the next buffer boundary without flushing the queue.
+    descr->tim_freq = frequency;
+    return 1;
+}
+
+TIM_HandleTypeDef *AdvancedDAC::sync_timer() {
+    // The DMA must be started, i.e. the first buffers written or playback started,
+    // and the timer must not be running.
+    if (descr == nullptr || descr->dmabuf[0] == nullptr || (descr->tim.Instance->CR1 & TIM_CR1_CEN)) {
+        return nullptr;
     }
+    return &descr->tim;
 }
 
 AdvancedDAC::~AdvancedDAC() {
@@ -222,11 +386,29 @@ extern "C" {
 void DAC_DMAConvCplt(DMA_HandleTypeDef *dma, uint32_t channel) {
     dac_descr_t *descr = dac_descr_get(channel);
 
+    if (descr && descr->playing) {
+        // NOTE: CT bit is inverted, to get the DMA buffer that's Not currently in use.
+        void *addr = hal_dma_play_next(&descr->play, ! hal_dma_get_ct(dma));
+        if (addr) {
+            hal_dma_update_memory(dma, addr);
+        } else {
+            dac_descr_deinit(descr, false);
+        }
+        return;
+    }
+
     // Release the DMA buffer that was just done, allocate a new one,
     // and update the next DMA memory address target.
     if (descr && descr->pool->readable()) {
         // NOTE: CT bit is inverted, to get the DMA buffer that's Not currently in use.
         size_t ct = ! hal_dma_get_ct(dma);
+        // Update the trigger timer if a frequency change is pending. Note that the
+        // timer's registers are preloaded, so the new rate starts on the next update
+        // event, i.e. with the first sample of the buffer the DMA has just switched to.
+        if (descr->tim_freq) {
+            hal_tim_set_freq(&descr->tim, descr->tim_freq);
+            descr->tim_freq = 0;
+        }
         descr->dmabuf[ct]->release();
         descr->dmabuf[ct] = descr->pool->alloc(DMA_BUFFER_READ);
         if (descr->loop_mode) {
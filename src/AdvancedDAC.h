@@ -21,6 +21,7 @@
 #define __ADVANCED_DAC_H__
 
 #include "AdvancedAnalog.h"
+#include "WavImage.h"
 
 struct dac_descr_t;
 
@@ -29,10 +30,22 @@ class AdvancedDAC {
         size_t n_channels;
         dac_descr_t *descr;
         PinName dac_pins[AN_MAX_DAC_CHANNELS];
+        uint32_t burst;
+        uint32_t fifo;
+        uint32_t memory;
+        void *arena;
+        size_t arena_size;
+        uint32_t priority;
+        bool sync_hold;
+        friend class AdvancedSync;
+        TIM_HandleTypeDef *sync_timer();
+        int play_dma(const void *data, size_t size, size_t sample_size, bool loop);
 
     public:
         template <typename ... T>
-        AdvancedDAC(pin_size_t p0, T ... args): n_channels(0), descr(nullptr) {
+        AdvancedDAC(pin_size_t p0, T ... args): n_channels(0), descr(nullptr),
+            burst(AN_DMA_BURST_SINGLE), fifo(AN_DMA_FIFO_FULL), memory(AN_DMA_MEM_CACHED),
+            arena(nullptr), arena_size(0), priority(AN_IRQ_PRIORITY_HIGHEST), sync_hold(false) {
             static_assert(sizeof ...(args) < AN_MAX_DAC_CHANNELS,
                     "A maximum of 1 channel is currently supported.");
 
@@ -48,6 +61,12 @@ class AdvancedDAC {
         int begin(uint32_t resolution, uint32_t frequency, size_t n_samples=0, size_t n_buffers=0, bool loop=false);
         int stop();
         int frequency(uint32_t const frequency);
+        int dma_burst(uint32_t burst, uint32_t fifo=AN_DMA_FIFO_FULL);
+        int dma_memory(uint32_t memory, void *arena=nullptr, size_t size=0);
+        int irq_priority(uint32_t priority);
+        int play(const Sample *data, size_t n_samples, bool loop=false);
+        int play(WavImage &wav, bool loop=false);
+        bool playing();
 };
 
 #endif // __ADVANCED_DAC_H__
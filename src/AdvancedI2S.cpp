@@ -21,33 +21,51 @@
 #include "HALConfig.h"
 #include "AdvancedI2S.h"
 
+template <typename T>
+struct i2s_stream_t {
+    DMAPool<T> *pool;
+    DMABuffer<T> *buf[2];
+    // Stereo staging buffers used as DMA targets for mono streams, or null.
+    DMAPool<T> *stage;
+    bool discont;
+    // True if the pools are in non-cacheable memory.
+    bool uncached;
+};
+
 struct i2s_descr_t {
     I2S_HandleTypeDef i2s;
     DMA_HandleTypeDef dmatx;
-    IRQn_Type dmatx_irqn;
-    DMAPool<Sample> *dmatx_pool;
-    DMABuffer<Sample> *dmatx_buf[2];
     DMA_HandleTypeDef dmarx;
-    IRQn_Type dmarx_irqn;
-    DMAPool<Sample> *dmarx_pool;
-    DMABuffer<Sample> *dmarx_buf[2];
+    size_t sample_size;
+    uint32_t sample_rate;
+    bool slave;
+    // Full-duplex process callback (AdvancedI2SImpl<T>::process_t), or null.
+    void *process;
+    // Playback of samples held in memory, see AdvancedI2SImpl<T>::play().
+    bool playing;
+    hal_dma_play_t play;
+    // NOTE: Only the streams that match the sample size are used.
+    i2s_stream_t<Sample> tx16;
+    i2s_stream_t<Sample> rx16;
+    i2s_stream_t<Sample32> tx32;
+    i2s_stream_t<Sample32> rx32;
 };
 
 static i2s_descr_t i2s_descr_all[] = {
     {
         {SPI1},
-        {DMA2_Stream1, {DMA_REQUEST_SPI1_TX}}, DMA2_Stream1_IRQn, nullptr, {nullptr, nullptr},
-        {DMA2_Stream2, {DMA_REQUEST_SPI1_RX}}, DMA2_Stream2_IRQn, nullptr, {nullptr, nullptr},
+        {nullptr, {DMA_REQUEST_SPI1_TX}},
+        {nullptr, {DMA_REQUEST_SPI1_RX}},
     },
     {
         {SPI2},
-        {DMA2_Stream3, {DMA_REQUEST_SPI2_TX}}, DMA2_Stream3_IRQn, nullptr, {nullptr, nullptr},
-        {DMA2_Stream4, {DMA_REQUEST_SPI2_RX}}, DMA2_Stream4_IRQn, nullptr, {nullptr, nullptr},
+        {nullptr, {DMA_REQUEST_SPI2_TX}},
+        {nullptr, {DMA_REQUEST_SPI2_RX}},
     },
     {
         {SPI3},
-        {DMA2_Stream5, {DMA_REQUEST_SPI3_TX}}, DMA2_Stream5_IRQn, nullptr, {nullptr, nullptr},
-        {DMA2_Stream6, {DMA_REQUEST_SPI3_RX}}, DMA2_Stream6_IRQn, nullptr, {nullptr, nullptr},
+        {nullptr, {DMA_REQUEST_SPI3_TX}},
+        {nullptr, {DMA_REQUEST_SPI3_RX}},
     },
 };
 
@@ -58,41 +76,42 @@ static const PinMap PinMap_SPI_MCK[] = {
     {NC, NC, 0}
 };
 
-extern "C" {
-
-void DMA2_Stream1_IRQHandler() {
-    HAL_DMA_IRQHandler(&i2s_descr_all[0].dmatx);
-}
+static uint32_t I2S_RES_LUT[] = {
+    0, 0, 0, 0, I2S_DATAFORMAT_16B_EXTENDED, I2S_DATAFORMAT_24B, I2S_DATAFORMAT_32B
+};
 
-void DMA2_Stream2_IRQHandler() {
-    HAL_DMA_IRQHandler(&i2s_descr_all[0].dmarx);
-}
+template <typename T> static i2s_stream_t<T> &i2s_tx_stream(i2s_descr_t *descr);
+template <typename T> static i2s_stream_t<T> &i2s_rx_stream(i2s_descr_t *descr);
 
-void DMA2_Stream3_IRQHandler() {
-    HAL_DMA_IRQHandler(&i2s_descr_all[1].dmatx);
+template <> i2s_stream_t<Sample> &i2s_tx_stream<Sample>(i2s_descr_t *descr) {
+    return descr->tx16;
 }
 
-void DMA2_Stream4_IRQHandler() {
-    HAL_DMA_IRQHandler(&i2s_descr_all[1].dmarx);
+template <> i2s_stream_t<Sample> &i2s_rx_stream<Sample>(i2s_descr_t *descr) {
+    return descr->rx16;
 }
 
-void DMA2_Stream5_IRQHandler() {
-    HAL_DMA_IRQHandler(&i2s_descr_all[2].dmatx);
+template <> i2s_stream_t<Sample32> &i2s_tx_stream<Sample32>(i2s_descr_t *descr) {
+    return descr->tx32;
 }
 
-void DMA2_Stream6_IRQHandler() {
-    HAL_DMA_IRQHandler(&i2s_descr_all[2].dmarx);
+template <> i2s_stream_t<Sample32> &i2s_rx_stream<Sample32>(i2s_descr_t *descr) {
+    return descr->rx32;
 }
 
-} // extern C
-
 static uint32_t i2s_hal_mode(i2s_mode_t i2s_mode) {
     if (i2s_mode == AN_I2S_MODE_OUT) {
         return I2S_MODE_MASTER_TX;
     } else if (i2s_mode == AN_I2S_MODE_IN) {
         return I2S_MODE_MASTER_RX;
-    } else {
+    } else if (i2s_mode == AN_I2S_MODE_INOUT) {
         return I2S_MODE_MASTER_FULLDUPLEX;
+    } else if (i2s_mode == AN_I2S_MODE_SLAVE_OUT) {
+        return I2S_MODE_SLAVE_TX;
+    } else if (i2s_mode == AN_I2S_MODE_SLAVE_IN) {
+        return I2S_MODE_SLAVE_RX;
+    } else {
+        return I2S_MODE_SLAVE_FULLDUPLEX;
     }
 }
 
@@ -107,66 +126,115 @@ static i2s_descr_t *i2s_descr_get(SPI_TypeDef *i2s) {
     return NULL;
 }
 
-static void i2s_descr_deinit(i2s_descr_t *descr, bool dealloc_pool) {
-    if (descr != nullptr) {
-        HAL_I2S_DMAStop(&descr->i2s);
-
-        for (size_t i=0; i<AN_ARRAY_SIZE(descr->dmatx_buf); i++) {
-            if (descr->dmatx_buf[i]) {
-                descr->dmatx_buf[i]->release();
-                descr->dmatx_buf[i] = nullptr;
-            }
+template <typename T>
+static void i2s_stream_deinit(i2s_stream_t<T> &stream, bool dealloc_pool) {
+    for (size_t i=0; i<AN_ARRAY_SIZE(stream.buf); i++) {
+        if (stream.buf[i]) {
+            stream.buf[i]->release();
+            stream.buf[i] = nullptr;
         }
+    }
 
-        for (size_t i=0; i<AN_ARRAY_SIZE(descr->dmarx_buf); i++) {
-            if (descr->dmatx_buf[i]) {
-                descr->dmatx_buf[i]->release();
-                descr->dmatx_buf[i] = nullptr;
-            }
+    if (stream.stage) {
+        stream.stage->flush();
+    }
+
+    if (dealloc_pool) {
+        if (stream.pool) {
+            hal_dma_pool_delete(stream.pool);
+        }
+        if (stream.stage) {
+            hal_dma_pool_delete(stream.stage);
         }
+        stream.pool = nullptr;
+        stream.stage = nullptr;
+        stream.discont = false;
+    } else if (stream.pool) {
+        stream.pool->flush();
+    }
+}
 
-        if (dealloc_pool) {
-            if (descr->dmarx_pool) {
-                delete descr->dmarx_pool;
-            }
-            descr->dmarx_pool = nullptr;
+template <typename T>
+static void i2s_unpack(T *mono, const T *stereo, size_t n_samples) {
+    // Mono streams use the left slot.
+    for (size_t i=0; i<n_samples; i++) {
+        mono[i] = stereo[i * 2];
+    }
+}
 
-            if (descr->dmatx_pool) {
-                delete descr->dmatx_pool;
-            }
-            descr->dmatx_pool = nullptr;
-        } else {
-            if (descr->dmarx_pool) {
-                descr->dmarx_pool->flush();
-            }
+template <typename T>
+static void i2s_pack(T *stereo, const T *mono, size_t n_samples) {
+    // Mono output is sent to both slots, so it works with either speaker/channel.
+    for (size_t i=0; i<n_samples; i++) {
+        stereo[i * 2 + 0] = mono[i];
+        stereo[i * 2 + 1] = mono[i];
+    }
+}
 
-            if (descr->dmatx_pool) {
-                descr->dmatx_pool->flush();
+template <typename T>
+static void i2s_stream_start(i2s_stream_t<T> &stream, uint32_t direction) {
+    if (direction == DMA_PERIPH_TO_MEMORY) {
+        for (size_t i=0; i<AN_ARRAY_SIZE(stream.buf); i++) {
+            stream.buf[i] = (stream.stage ? stream.stage : stream.pool)->alloc(DMA_BUFFER_WRITE);
+        }
+    } else if (stream.buf[0] == nullptr) {
+        // NOTE: In process mode, the transmit buffers are already allocated.
+        for (size_t i=0; i<AN_ARRAY_SIZE(stream.buf); i++) {
+            if (stream.stage == nullptr) {
+                stream.buf[i] = stream.pool->alloc(DMA_BUFFER_READ);
+            } else {
+                DMABuffer<T> *buf = stream.pool->alloc(DMA_BUFFER_READ);
+                stream.buf[i] = stream.stage->alloc(DMA_BUFFER_WRITE);
+                i2s_pack(stream.buf[i]->data(), buf->data(), buf->size());
+                if (!stream.uncached) {
+                    stream.buf[i]->flush();
+                }
+                buf->release();
             }
         }
     }
 }
 
+static void i2s_descr_deinit(i2s_descr_t *descr, bool dealloc_pool) {
+    if (descr != nullptr) {
+        HAL_I2S_DMAStop(&descr->i2s);
+        descr->playing = false;
+        if (dealloc_pool) {
+            descr->process = nullptr;
+        }
+        i2s_stream_deinit(descr->tx16, dealloc_pool);
+        i2s_stream_deinit(descr->rx16, dealloc_pool);
+        i2s_stream_deinit(descr->tx32, dealloc_pool);
+        i2s_stream_deinit(descr->rx32, dealloc_pool);
+        if (dealloc_pool) {
+            hal_dma_free(&descr->dmatx);
+            hal_dma_free(&descr->dmarx);
+        }
+    }
+}
+
+template <typename T>
 static int i2s_start_dma_transfer(i2s_descr_t *descr, i2s_mode_t i2s_mode) {
+    i2s_stream_t<T> &tx = i2s_tx_stream<T>(descr);
+    i2s_stream_t<T> &rx = i2s_rx_stream<T>(descr);
     uint16_t *tx_buf = NULL;
     uint16_t *rx_buf = NULL;
     uint16_t buf_size = 0;
 
+    // NOTE: The HAL takes the transfer size in data frames (16 or 32-bit words
+    // depending on the data format), which is the buffer size in samples.
     if (i2s_mode & AN_I2S_MODE_IN) {
-        // Start I2S DMA.
-        descr->dmarx_buf[0] = descr->dmarx_pool->alloc(DMA_BUFFER_WRITE);
-        descr->dmarx_buf[1] = descr->dmarx_pool->alloc(DMA_BUFFER_WRITE);
-        rx_buf = (uint16_t *) descr->dmarx_buf[0]->data();
-        buf_size = descr->dmarx_buf[0]->size();
-        HAL_NVIC_DisableIRQ(descr->dmarx_irqn);
+        i2s_stream_start(rx, DMA_PERIPH_TO_MEMORY);
+        rx_buf = (uint16_t *) rx.buf[0]->data();
+        buf_size = rx.buf[0]->size();
+        HAL_NVIC_DisableIRQ(hal_dma_irqn(&descr->dmarx));
     }
 
     if (i2s_mode & AN_I2S_MODE_OUT) {
-        descr->dmatx_buf[0] = descr->dmatx_pool->alloc(DMA_BUFFER_READ);
-        descr->dmatx_buf[1] = descr->dmatx_pool->alloc(DMA_BUFFER_READ);
-        tx_buf = (uint16_t *) descr->dmatx_buf[0]->data();
-        buf_size = descr->dmatx_buf[0]->size();
-        HAL_NVIC_DisableIRQ(descr->dmatx_irqn);
+        i2s_stream_start(tx, DMA_MEMORY_TO_PERIPH);
+        tx_buf = (uint16_t *) tx.buf[0]->data();
+        buf_size = tx.buf[0]->size();
+        HAL_NVIC_DisableIRQ(hal_dma_irqn(&descr->dmatx));
     }
 
     // Start I2S DMA.
@@ -186,54 +254,62 @@ static int i2s_start_dma_transfer(i2s_descr_t *descr, i2s_mode_t i2s_mode) {
     HAL_I2S_DMAPause(&descr->i2s);
     // Re/enable DMA double buffer mode.
     if (i2s_mode & AN_I2S_MODE_IN) {
-        hal_dma_enable_dbm(&descr->dmarx, descr->dmarx_buf[0]->data(), descr->dmarx_buf[1]->data());
-        HAL_NVIC_EnableIRQ(descr->dmarx_irqn);
+        hal_dma_enable_dbm(&descr->dmarx, rx.buf[0]->data(), rx.buf[1]->data());
+        HAL_NVIC_EnableIRQ(hal_dma_irqn(&descr->dmarx));
     }
 
     if (i2s_mode & AN_I2S_MODE_OUT) {
-        hal_dma_enable_dbm(&descr->dmatx, descr->dmatx_buf[0]->data(), descr->dmatx_buf[1]->data());
-        HAL_NVIC_EnableIRQ(descr->dmatx_irqn);
+        hal_dma_enable_dbm(&descr->dmatx, tx.buf[0]->data(), tx.buf[1]->data());
+        HAL_NVIC_EnableIRQ(hal_dma_irqn(&descr->dmatx));
     }
     HAL_I2S_DMAResume(&descr->i2s);
     return 1;
 }
 
-bool AdvancedI2S::available() {
+template <typename T>
+bool AdvancedI2SImpl<T>::available() {
     if (descr != nullptr) {
-        if (i2s_mode == AN_I2S_MODE_IN && descr->dmarx_pool) {
-            return descr->dmarx_pool->readable();
-        } else if (i2s_mode == AN_I2S_MODE_OUT && descr->dmatx_pool) {
-            return descr->dmatx_pool->writable();
-        } else if (descr->dmatx_pool && descr->dmarx_pool) {
-            return descr->dmarx_pool->readable() && descr->dmatx_pool->writable();
+        i2s_stream_t<T> &tx = i2s_tx_stream<T>(descr);
+        i2s_stream_t<T> &rx = i2s_rx_stream<T>(descr);
+        if (i2s_mode == AN_I2S_MODE_IN && rx.pool) {
+            return rx.pool->readable();
+        } else if (i2s_mode == AN_I2S_MODE_OUT && tx.pool) {
+            return tx.pool->writable();
+        } else if (tx.pool && rx.pool) {
+            return rx.pool->readable() && tx.pool->writable();
         }
     }
     return false;
 }
 
-DMABuffer<Sample> &AdvancedI2S::read() {
-    static DMABuffer<Sample> NULLBUF;
-    if (descr && descr->dmarx_pool) {
-        while (!descr->dmarx_pool->readable()) {
+template <typename T>
+DMABuffer<T> &AdvancedI2SImpl<T>::read() {
+    static DMABuffer<T> NULLBUF;
+    if (descr && i2s_rx_stream<T>(descr).pool) {
+        DMAPool<T> *pool = i2s_rx_stream<T>(descr).pool;
+        while (!pool->readable()) {
             __WFI();
         }
-        return *descr->dmarx_pool->alloc(DMA_BUFFER_READ);
+        return *pool->alloc(DMA_BUFFER_READ);
     }
     return NULLBUF;
 }
 
-DMABuffer<Sample> &AdvancedI2S::dequeue() {
-    static DMABuffer<Sample> NULLBUF;
-    if (descr && descr->dmatx_pool) {
-        while (!descr->dmatx_pool->writable()) {
+template <typename T>
+DMABuffer<T> &AdvancedI2SImpl<T>::dequeue() {
+    static DMABuffer<T> NULLBUF;
+    if (descr && i2s_tx_stream<T>(descr).pool) {
+        DMAPool<T> *pool = i2s_tx_stream<T>(descr).pool;
+        while (!pool->writable()) {
             __WFI();
         }
-        return *descr->dmatx_pool->alloc(DMA_BUFFER_WRITE);
+        return *pool->alloc(DMA_BUFFER_WRITE);
     }
     return NULLBUF;
 }
 
-void AdvancedI2S::write(DMABuffer<Sample> &dmabuf) {
+template <typename T>
+void AdvancedI2SImpl<T>::write(DMABuffer<T> &dmabuf) {
     static uint32_t buf_count = 0;
 
     if (descr == nullptr) {
@@ -241,19 +317,36 @@ void AdvancedI2S::write(DMABuffer<Sample> &dmabuf) {
     }
 
     // Make sure any cached data is flushed.
-    dmabuf.flush();
+    if (!i2s_tx_stream<T>(descr).uncached) {
+        dmabuf.flush();
+    }
     dmabuf.release();
 
-    if (descr->dmatx_buf[0] == nullptr && (++buf_count % 3) == 0) {
-        i2s_start_dma_transfer(descr, i2s_mode);
+    if (i2s_tx_stream<T>(descr).buf[0] == nullptr && (++buf_count % 3) == 0) {
+        i2s_start_dma_transfer<T>(descr, i2s_mode);
     }
 }
 
-int AdvancedI2S::begin(i2s_mode_t i2s_mode, uint32_t sample_rate, size_t n_samples, size_t n_buffers) {
-    this->i2s_mode = i2s_mode;
+template <typename T>
+int AdvancedI2SImpl<T>::init(i2s_mode_t i2s_mode, uint32_t sample_rate, size_t n_samples,
+                             size_t n_buffers, uint32_t resolution, size_t n_channels) {
+    // NOTE: The stored mode is only the direction, the slave flag is kept in the descriptor.
+    bool slave = i2s_mode & AN_I2S_MODE_SLAVE;
+    this->i2s_mode = (i2s_mode_t) (i2s_mode & AN_I2S_MODE_INOUT);
 
     // Sanity checks.
-    if (sample_rate < 8000 || sample_rate > 192000 || descr != nullptr) {
+    if (sample_rate < 8000 || sample_rate > 192000 || n_channels < 1 || n_channels > 2 || descr != nullptr) {
+        return 0;
+    }
+
+    // The buffers must hold a whole number of DMA bursts.
+    if (hal_dma_check_burst(burst, fifo, sizeof(T), n_samples * n_channels * sizeof(T)) < 0) {
+        return 0;
+    }
+
+    // 16-bit data uses 16-bit samples, and 24/32-bit data uses 32-bit samples.
+    if (resolution >= AN_ARRAY_SIZE(I2S_RES_LUT) || I2S_RES_LUT[resolution] == 0 ||
+       ((resolution == AN_RESOLUTION_16) != (sizeof(T) == 2))) {
         return 0;
     }
 
@@ -284,15 +377,34 @@ int AdvancedI2S::begin(i2s_mode_t i2s_mode, uint32_t sample_rate, size_t n_sampl
         return 0;
     }
 
+    descr->sample_size = sizeof(T);
+    descr->sample_rate = sample_rate;
+    descr->slave = slave;
+
+    // Both directions' pools are carved from the same arena, if any. From here on, failures
+    // free the pools and DMA streams, so the descriptor can be used again.
+    hal_dma_arena_t mem = {(uint8_t *) arena, arena_size};
+
     if (i2s_mode & AN_I2S_MODE_IN) {
         // Allocate DMA buffer pool.
-        descr->dmarx_pool = new DMAPool<Sample>(n_samples, 2, n_buffers);
-        if (descr->dmarx_pool == nullptr) {
+        i2s_stream_t<T> &rx = i2s_rx_stream<T>(descr);
+        rx.pool = hal_dma_pool_new<T>(n_samples, n_channels, n_buffers, memory, &mem);
+        if (rx.pool == nullptr) {
+            i2s_descr_deinit(descr, true);
             descr = nullptr;
             return 0;
         }
+        // Mono streams are captured in stereo, and unpacked into the pool.
+        if (n_channels == 1 && (rx.stage = hal_dma_pool_new<T>(n_samples, 2, 2, memory, &mem)) == nullptr) {
+            i2s_descr_deinit(descr, true);
+            descr = nullptr;
+            return 0;
+        }
+        rx.uncached = (memory == AN_DMA_MEM_UNCACHED);
         // Init and config DMA.
-        if (hal_dma_config(&descr->dmarx, descr->dmarx_irqn, DMA_PERIPH_TO_MEMORY) != 0) {
+        if (hal_dma_config(&descr->dmarx, DMA_PERIPH_TO_MEMORY, sizeof(T), burst, fifo, priority) != 0) {
+            i2s_descr_deinit(descr, true);
+            descr = nullptr;
             return 0;
         }
         __HAL_LINKDMA(&descr->i2s, hdmarx, descr->dmarx);
@@ -300,32 +412,58 @@ int AdvancedI2S::begin(i2s_mode_t i2s_mode, uint32_t sample_rate, size_t n_sampl
 
     if (i2s_mode & AN_I2S_MODE_OUT) {
         // Allocate DMA buffer pool.
-        descr->dmatx_pool = new DMAPool<Sample>(n_samples, 2, n_buffers);
-        if (descr->dmatx_pool == nullptr) {
+        i2s_stream_t<T> &tx = i2s_tx_stream<T>(descr);
+        tx.pool = hal_dma_pool_new<T>(n_samples, n_channels, n_buffers, memory, &mem);
+        if (tx.pool == nullptr) {
+            i2s_descr_deinit(descr, true);
             descr = nullptr;
             return 0;
         }
+        // Mono streams are packed into stereo staging buffers for transmission.
+        if (n_channels == 1 && (tx.stage = hal_dma_pool_new<T>(n_samples, 2, 2, memory, &mem)) == nullptr) {
+            i2s_descr_deinit(descr, true);
+            descr = nullptr;
+            return 0;
+        }
+        tx.uncached = (memory == AN_DMA_MEM_UNCACHED);
         // Init and config DMA.
-        if (hal_dma_config(&descr->dmatx, descr->dmatx_irqn, DMA_MEMORY_TO_PERIPH) != 0) {
+        if (hal_dma_config(&descr->dmatx, DMA_MEMORY_TO_PERIPH, sizeof(T), burst, fifo, priority) != 0) {
+            i2s_descr_deinit(descr, true);
+            descr = nullptr;
             return 0;
         }
         __HAL_LINKDMA(&descr->i2s, hdmatx, descr->dmatx);
     }
 
-    // Init and config I2S.
-    if (hal_i2s_config(&descr->i2s, sample_rate, i2s_hal_mode(i2s_mode), i2s_pins[4] != NC) != 0) {
+    // Init and config I2S. In slave mode, WS and CK are inputs and MCLK can't be generated,
+    // and PLL3 is left as is, so a slave never retunes the clock of a running master.
+    if (hal_i2s_config(&descr->i2s, sample_rate, i2s_hal_mode(i2s_mode),
+                       i2s_pins[4] != NC && !slave, I2S_RES_LUT[resolution]) != 0) {
+        i2s_descr_deinit(descr, true);
+        descr = nullptr;
         return 0;
     }
+    return 1;
+}
 
-    if (i2s_mode == AN_I2S_MODE_IN) {
-        return i2s_start_dma_transfer(descr, i2s_mode);
+template <typename T>
+int AdvancedI2SImpl<T>::begin(i2s_mode_t i2s_mode, uint32_t sample_rate, size_t n_samples,
+                              size_t n_buffers, uint32_t resolution, size_t n_channels) {
+    if (!init(i2s_mode, sample_rate, n_samples, n_buffers, resolution, n_channels)) {
+        return 0;
+    }
+
+    if (this->i2s_mode == AN_I2S_MODE_IN && !i2s_start_dma_transfer<T>(descr, this->i2s_mode)) {
+        i2s_descr_deinit(descr, true);
+        descr = nullptr;
+        return 0;
     }
 
-    if (i2s_mode == AN_I2S_MODE_INOUT) {
+    if (this->i2s_mode == AN_I2S_MODE_INOUT) {
         // The transmit pool has to be primed with a few buffers first, before the
         // DMA can be started in full-duplex mode.
         for (int i=0; i<3; i++) {
-            SampleBuffer outbuf = dequeue();
+            DMABuffer<T> &outbuf = dequeue();
             memset(outbuf.data(), 0, outbuf.bytes());
             write(outbuf);
         }
@@ -333,75 +471,335 @@ int AdvancedI2S::begin(i2s_mode_t i2s_mode, uint32_t sample_rate, size_t n_sampl
     return 1;
 }
 
-int AdvancedI2S::stop() {
+template <typename T>
+int AdvancedI2SImpl<T>::begin(process_t process, uint32_t sample_rate, size_t n_samples, uint32_t resolution) {
+    // In process mode, the buffers are never queued; the DMA owns exactly two buffers per
+    // direction, and the callback fills the transmit buffer that was just sent, from the
+    // receive buffer that was just filled. So the output is always one buffer behind the
+    // input, regardless of how long the main loop takes.
+    if (process == nullptr || !init(AN_I2S_MODE_INOUT, sample_rate, n_samples, 2, resolution, 2)) {
+        return 0;
+    }
+
+    i2s_stream_t<T> &tx = i2s_tx_stream<T>(descr);
+    for (size_t i=0; i<AN_ARRAY_SIZE(tx.buf); i++) {
+        tx.buf[i] = tx.pool->alloc(DMA_BUFFER_WRITE);
+        memset(tx.buf[i]->data(), 0, tx.buf[i]->bytes());
+        if (!tx.uncached) {
+            tx.buf[i]->flush();
+        }
+    }
+
+    descr->process = (void *) process;
+    if (!i2s_start_dma_transfer<T>(descr, AN_I2S_MODE_INOUT)) {
+        i2s_descr_deinit(descr, true);
+        descr = nullptr;
+        return 0;
+    }
+    return 1;
+}
+
+template <typename T>
+float AdvancedI2SImpl<T>::frequency() {
+    if (descr == nullptr) {
+        return 0.0f;
+    }
+    // In slave mode, the rate is set by the external clock.
+    if (descr->slave) {
+        return descr->sample_rate;
+    }
+    return hal_i2s_get_freq(&descr->i2s);
+}
+
+template <typename T>
+int AdvancedI2SImpl<T>::trim(float ppm) {
+    if (descr == nullptr || descr->slave) {
+        return 0;
+    }
+    // The rate is always trimmed relative to the nominal one, so trims don't accumulate.
+    float sample_rate = descr->sample_rate * (1.0f + ppm * 1e-6f);
+    return hal_i2s_set_freq(&descr->i2s, sample_rate) == 0;
+}
+
+template <typename T>
+int AdvancedI2SImpl<T>::dma_burst(uint32_t burst, uint32_t fifo) {
+    // Must be called before begin().
+    if (descr != nullptr || hal_dma_check_burst(burst, fifo, sizeof(T), 0) < 0) {
+        return 0;
+    }
+    this->burst = burst;
+    this->fifo = fifo;
+    return 1;
+}
+
+template <typename T>
+int AdvancedI2SImpl<T>::dma_memory(uint32_t memory, void *arena, size_t size) {
+    // Must be called before begin().
+    if (descr != nullptr || memory > AN_DMA_MEM_UNCACHED ||
+       (memory == AN_DMA_MEM_UNCACHED && arena == nullptr && hal_dma_mem_check() < 0)) {
+        return 0;
+    }
+    this->memory = memory;
+    this->arena = arena;
+    this->arena_size = size;
+    return 1;
+}
+
+template <typename T>
+int AdvancedI2SImpl<T>::irq_priority(uint32_t priority) {
+    if (priority > AN_IRQ_PRIORITY_LOWEST) {
+        return 0;
+    }
+    this->priority = priority;
+    // If I2S is running, the new priority takes effect immediately.
+    if (descr != nullptr) {
+        hal_dma_set_priority(&descr->dmarx, priority);
+        hal_dma_set_priority(&descr->dmatx, priority);
+    }
+    return 1;
+}
+
+template <typename T>
+int AdvancedI2SImpl<T>::stop() {
     i2s_descr_deinit(descr, true);
     descr = nullptr;
     return 1;
 }
 
-AdvancedI2S::~AdvancedI2S() {
+template <typename T>
+AdvancedI2SImpl<T>::~AdvancedI2SImpl() {
     i2s_descr_deinit(descr, true);
 }
 
-extern "C" {
+template <typename T>
+int AdvancedI2SImpl<T>::play(const T *data, size_t n_samples, bool loop) {
+    // Samples are sent in place, so this only works for stereo output without staging,
+    // while the transmit stream is idle. Two buffers from the pool are used as pad
+    // buffers for the end of the samples, so their size sets the size of the transfers.
+    if (descr == nullptr || !(i2s_mode & AN_I2S_MODE_OUT) || (i2s_mode & AN_I2S_MODE_IN) ||
+        data == nullptr || ((uintptr_t) data % sizeof(T)) || n_samples < 2) {
+        return 0;
+    }
 
-void HAL_I2S_TxCpltCallback(I2S_HandleTypeDef *i2s) {
-    i2s_descr_t *descr = i2s_descr_get(i2s->Instance);
-    
-    if (descr == nullptr) {
-        return;
+    // Bursts must not cross a 1KB boundary, so the samples must be aligned to the burst size.
+    if (burst != AN_DMA_BURST_SINGLE && ((uintptr_t) data % ((2U << burst) * sizeof(T)))) {
+        return 0;
+    }
+
+    i2s_stream_t<T> &tx = i2s_tx_stream<T>(descr);
+    if (tx.stage || tx.buf[0] != nullptr) {
+        return 0;
+    }
+
+    tx.buf[0] = tx.pool->alloc(DMA_BUFFER_WRITE);
+    tx.buf[1] = tx.pool->alloc(DMA_BUFFER_WRITE);
+    if (tx.buf[0] == nullptr || tx.buf[1] == nullptr) {
+        i2s_descr_deinit(descr, false);
+        return 0;
+    }
+
+    hal_dma_play_init(&descr->play, data, n_samples * sizeof(T), tx.buf[0]->bytes(),
+                      tx.buf[0]->data(), tx.buf[1]->data(), sizeof(T), 0, loop);
+    void *m0 = hal_dma_play_next(&descr->play, 0);
+    void *m1 = hal_dma_play_next(&descr->play, 1);
+    descr->playing = true;
+
+    // Start I2S DMA.
+    HAL_NVIC_DisableIRQ(hal_dma_irqn(&descr->dmatx));
+    if (HAL_I2S_Transmit_DMA(&descr->i2s, (uint16_t *) m0, tx.buf[0]->size()) != HAL_OK) {
+        i2s_descr_deinit(descr, false);
+        return 0;
     }
+    HAL_I2S_DMAPause(&descr->i2s);
+    // Re/enable DMA double buffer mode.
+    hal_dma_enable_dbm(&descr->dmatx, m0, m1);
+    HAL_NVIC_EnableIRQ(hal_dma_irqn(&descr->dmatx));
+    HAL_I2S_DMAResume(&descr->i2s);
+    return 1;
+}
+
+template <typename T>
+int AdvancedI2SImpl<T>::play(WavImage &wav, bool loop) {
+    // The WAV samples must match the I2S data format.
+    if (wav.channels() != 2 || wav.resolution() != sizeof(T) * 8) {
+        return 0;
+    }
+    return play((const T *) wav.data(), wav.bytes() / sizeof(T), loop);
+}
+
+template <typename T>
+bool AdvancedI2SImpl<T>::playing() {
+    return descr != nullptr && descr->playing;
+}
+
+template class AdvancedI2SImpl<Sample>;
+template class AdvancedI2SImpl<Sample32>;
+
+template <typename T>
+static void i2s_tx_cplt(i2s_descr_t *descr) {
+    i2s_stream_t<T> &tx = i2s_tx_stream<T>(descr);
 
     // NOTE: CT bit is inverted, to get the DMA buffer that's Not currently in use.
     size_t ct = ! hal_dma_get_ct(&descr->dmatx);
 
+    if (descr->playing) {
+        void *addr = hal_dma_play_next(&descr->play, ct);
+        if (addr) {
+            hal_dma_update_memory(&descr->dmatx, addr);
+        } else {
+            i2s_descr_deinit(descr, false);
+        }
+        return;
+    }
+
+    if (tx.stage) {
+        // Mono stream: pack the next buffer into the staging buffer that was just used.
+        if (tx.pool->readable()) {
+            DMABuffer<T> *buf = tx.pool->alloc(DMA_BUFFER_READ);
+            i2s_pack(tx.buf[ct]->data(), buf->data(), buf->size());
+            // Make sure any cached data is flushed.
+            if (!tx.uncached) {
+                tx.buf[ct]->flush();
+            }
+            buf->release();
+        } else {
+            i2s_descr_deinit(descr, false);
+        }
+        return;
+    }
+
     // Release the DMA buffer that was just used, dequeue the next one, and update
     // the next DMA memory address target.
-    if (descr->dmatx_pool->readable()) {
-        descr->dmatx_buf[ct]->release();
-        descr->dmatx_buf[ct] = descr->dmatx_pool->alloc(DMA_BUFFER_READ);
-        hal_dma_update_memory(&descr->dmatx, descr->dmatx_buf[ct]->data());
+    if (tx.pool->readable()) {
+        tx.buf[ct]->release();
+        tx.buf[ct] = tx.pool->alloc(DMA_BUFFER_READ);
+        hal_dma_update_memory(&descr->dmatx, tx.buf[ct]->data());
     } else {
         i2s_descr_deinit(descr, false);
     }
 }
 
-void HAL_I2S_RxCpltCallback(I2S_HandleTypeDef *i2s) {
-    i2s_descr_t *descr = i2s_descr_get(i2s->Instance);
-
-    if (descr == nullptr) {
-        return;
-    }
+template <typename T>
+static void i2s_rx_cplt(i2s_descr_t *descr) {
+    i2s_stream_t<T> &rx = i2s_rx_stream<T>(descr);
 
     // NOTE: CT bit is inverted, to get the DMA buffer that's Not currently in use.
     size_t ct = ! hal_dma_get_ct(&descr->dmarx);
 
+    if (rx.stage) {
+        // Mono stream: unpack the staging buffer that was just filled into a new buffer.
+        if (rx.pool->writable()) {
+            DMABuffer<T> *buf = rx.pool->alloc(DMA_BUFFER_WRITE);
+            // Make sure any cached data is discarded.
+            if (!rx.uncached) {
+                rx.buf[ct]->invalidate();
+            }
+            i2s_unpack(buf->data(), rx.buf[ct]->data(), buf->size());
+            buf->timestamp(us_ticker_read());
+            if (rx.discont) {
+                buf->set_flags(DMA_BUFFER_DISCONT);
+            }
+            rx.discont = false;
+            buf->release();
+        } else {
+            rx.discont = true;
+        }
+        return;
+    }
+
     // Update the buffer's timestamp.
-    descr->dmarx_buf[ct]->timestamp(us_ticker_read());
+    rx.buf[ct]->timestamp(us_ticker_read());
 
     // Flush the DMA buffer that was just used, move it to the ready queue, and
     // allocate a new one.
-    if (descr->dmarx_pool->writable()) {
+    if (rx.pool->writable()) {
         // Make sure any cached data is discarded.
-        descr->dmarx_buf[ct]->invalidate();
+        if (!rx.uncached) {
+            rx.buf[ct]->invalidate();
+        }
         // Move current DMA buffer to ready queue.
-        descr->dmarx_buf[ct]->release();
+        rx.buf[ct]->release();
         // Allocate a new free buffer.
-        descr->dmarx_buf[ct] = descr->dmarx_pool->alloc(DMA_BUFFER_WRITE);
+        rx.buf[ct] = rx.pool->alloc(DMA_BUFFER_WRITE);
         // Currently, all multi-channel buffers are interleaved.
-        if (descr->dmarx_buf[ct]->channels() > 1) {
-            descr->dmarx_buf[ct]->set_flags(DMA_BUFFER_INTRLVD);
+        if (rx.buf[ct]->channels() > 1) {
+            rx.buf[ct]->set_flags(DMA_BUFFER_INTRLVD);
         }
     } else {
-        descr->dmarx_buf[ct]->set_flags(DMA_BUFFER_DISCONT);
+        rx.buf[ct]->set_flags(DMA_BUFFER_DISCONT);
     }
 
     // Update the next DMA target pointer.
     // NOTE: If the pool was empty, the same buffer is reused.
-    hal_dma_update_memory(&descr->dmarx, descr->dmarx_buf[ct]->data());
+    hal_dma_update_memory(&descr->dmarx, rx.buf[ct]->data());
+}
+
+template <typename T>
+static void i2s_process_cplt(i2s_descr_t *descr) {
+    i2s_stream_t<T> &tx = i2s_tx_stream<T>(descr);
+    i2s_stream_t<T> &rx = i2s_rx_stream<T>(descr);
+
+    // NOTE: CT bit is inverted, to get the DMA buffers that are Not currently in use.
+    // The transmit DMA runs slightly ahead of the receive DMA, so by the time the
+    // receive buffer is complete, the transmit DMA has already switched buffers too.
+    DMABuffer<T> *rxbuf = rx.buf[! hal_dma_get_ct(&descr->dmarx)];
+    DMABuffer<T> *txbuf = tx.buf[! hal_dma_get_ct(&descr->dmatx)];
+
+    rxbuf->timestamp(us_ticker_read());
+    rxbuf->set_flags(DMA_BUFFER_INTRLVD);
+    // Make sure any cached data is discarded.
+    if (!rx.uncached) {
+        rxbuf->invalidate();
+    }
+    ((typename AdvancedI2SImpl<T>::process_t) descr->process)(*rxbuf, *txbuf);
+    // Make sure any cached data is flushed.
+    if (!tx.uncached) {
+        txbuf->flush();
+    }
+}
+
+extern "C" {
+
+void HAL_I2S_TxCpltCallback(I2S_HandleTypeDef *i2s) {
+    i2s_descr_t *descr = i2s_descr_get(i2s->Instance);
+    
+    if (descr == nullptr) {
+        return;
+    }
+
+    if (descr->sample_size == sizeof(Sample32)) {
+        i2s_tx_cplt<Sample32>(descr);
+    } else {
+        i2s_tx_cplt<Sample>(descr);
+    }
+}
+
+void HAL_I2S_RxCpltCallback(I2S_HandleTypeDef *i2s) {
+    i2s_descr_t *descr = i2s_descr_get(i2s->Instance);
+
+    if (descr == nullptr) {
+        return;
+    }
+
+    if (descr->sample_size == sizeof(Sample32)) {
+        i2s_rx_cplt<Sample32>(descr);
+    } else {
+        i2s_rx_cplt<Sample>(descr);
+    }
 }
 
 void HAL_I2SEx_TxRxCpltCallback(I2S_HandleTypeDef *i2s) {
+    i2s_descr_t *descr = i2s_descr_get(i2s->Instance);
+
+    if (descr != nullptr && descr->process != nullptr) {
+        if (descr->sample_size == sizeof(Sample32)) {
+            i2s_process_cplt<Sample32>(descr);
+        } else {
+            i2s_process_cplt<Sample>(descr);
+        }
+        return;
+    }
+
     HAL_I2S_RxCpltCallback(i2s);
     HAL_I2S_TxCpltCallback(i2s);
 }
@@ -20,37 +20,74 @@
 #define __ADVANCED_I2S_H__
 
 #include "AdvancedAnalog.h"
+#include "WavImage.h"
 
 struct i2s_descr_t;
 
 typedef enum {
-    AN_I2S_MODE_IN      = (1U << 0U),
-    AN_I2S_MODE_OUT     = (1U << 1U),
-    AN_I2S_MODE_INOUT   = (AN_I2S_MODE_IN | AN_I2S_MODE_OUT),
+    AN_I2S_MODE_IN          = (1U << 0U),
+    AN_I2S_MODE_OUT         = (1U << 1U),
+    AN_I2S_MODE_INOUT       = (AN_I2S_MODE_IN | AN_I2S_MODE_OUT),
+    AN_I2S_MODE_SLAVE       = (1U << 2U),
+    AN_I2S_MODE_SLAVE_IN    = (AN_I2S_MODE_SLAVE | AN_I2S_MODE_IN),
+    AN_I2S_MODE_SLAVE_OUT   = (AN_I2S_MODE_SLAVE | AN_I2S_MODE_OUT),
+    AN_I2S_MODE_SLAVE_INOUT = (AN_I2S_MODE_SLAVE | AN_I2S_MODE_INOUT),
 } i2s_mode_t;
 
-class AdvancedI2S {
+template <typename T>
+class AdvancedI2SImpl {
     private:
         i2s_descr_t *descr;
         PinName i2s_pins[5];
         i2s_mode_t i2s_mode;
+        uint32_t burst;
+        uint32_t fifo;
+        uint32_t memory;
+        void *arena;
+        size_t arena_size;
+        uint32_t priority;
+        int init(i2s_mode_t i2s_mode, uint32_t sample_rate, size_t n_samples,
+                 size_t n_buffers, uint32_t resolution, size_t n_channels);
 
     public:
-        AdvancedI2S(PinName ws, PinName ck, PinName sdi, PinName sdo, PinName mck):
-            descr(nullptr), i2s_pins{ws, ck, sdi, sdo, mck} {
+        // Full-duplex process callback, called from the DMA interrupt with the receive
+        // buffer that was just filled, and the transmit buffer to fill.
+        typedef void (*process_t)(DMABuffer<T> &rx, DMABuffer<T> &tx);
+
+        AdvancedI2SImpl(PinName ws, PinName ck, PinName sdi, PinName sdo, PinName mck):
+            descr(nullptr), i2s_pins{ws, ck, sdi, sdo, mck}, burst(AN_DMA_BURST_SINGLE), fifo(AN_DMA_FIFO_FULL),
+            memory(AN_DMA_MEM_CACHED), arena(nullptr), arena_size(0), priority(AN_IRQ_PRIORITY_HIGHEST) {
         }
 
-        AdvancedI2S() {
+        AdvancedI2SImpl(): descr(nullptr), i2s_pins{NC, NC, NC, NC, NC},
+            burst(AN_DMA_BURST_SINGLE), fifo(AN_DMA_FIFO_FULL), memory(AN_DMA_MEM_CACHED),
+            arena(nullptr), arena_size(0), priority(AN_IRQ_PRIORITY_HIGHEST) {
         }
 
-        ~AdvancedI2S();
+        ~AdvancedI2SImpl();
 
         bool available();
-        SampleBuffer read();
-        SampleBuffer dequeue();
-        void write(SampleBuffer dmabuf);
-        int begin(i2s_mode_t i2s_mode, uint32_t sample_rate, size_t n_samples, size_t n_buffers);
+        DMABuffer<T> &read();
+        DMABuffer<T> &dequeue();
+        void write(DMABuffer<T> &dmabuf);
+        int begin(i2s_mode_t i2s_mode, uint32_t sample_rate, size_t n_samples, size_t n_buffers,
+                  uint32_t resolution=(sizeof(T) == 2) ? AN_RESOLUTION_16 : AN_RESOLUTION_32, size_t n_channels=2);
+        int begin(process_t process, uint32_t sample_rate, size_t n_samples,
+                  uint32_t resolution=(sizeof(T) == 2) ? AN_RESOLUTION_16 : AN_RESOLUTION_32);
+        int play(const T *data, size_t n_samples, bool loop=false);
+        int play(WavImage &wav, bool loop=false);
+        bool playing();
+        float frequency();
+        int trim(float ppm);
+        int dma_burst(uint32_t burst, uint32_t fifo=AN_DMA_FIFO_FULL);
+        int dma_memory(uint32_t memory, void *arena=nullptr, size_t size=0);
+        int irq_priority(uint32_t priority);
         int stop();
 };
 
+// 16-bit I2S, using the default Sample type.
+typedef AdvancedI2SImpl<Sample>     AdvancedI2S;
+// 24-bit and 32-bit I2S, using 32-bit samples and word-aligned DMA transfers.
+typedef AdvancedI2SImpl<Sample32>   AdvancedI2S32;
+
 #endif // __ADVANCED_I2S_H__
@@ -0,0 +1,87 @@
+/*
+  This file is part of the Arduino_AdvancedAnalog library.
+  Copyright (c) 2024 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Arduino.h"
+#include "AdvancedPDM.h"
+
+AdvancedPDM::~AdvancedPDM() {
+    stop();
+}
+
+int AdvancedPDM::begin(uint32_t sample_rate, size_t n_samples, size_t n_buffers, float gain) {
+    if (pool != nullptr || n_samples == 0) {
+        return 0;
+    }
+
+    if (!decimator.begin(gain)) {
+        return 0;
+    }
+
+    pool = new DMAPool<Sample>(n_samples, 1, AN_PDM_PCM_BUFFERS);
+    if (pool == nullptr) {
+        return 0;
+    }
+
+    // The bitstream is captured as a 32-bit stereo I2S stream: a frame is 64 bits,
+    // so the bit clock, which drives the microphone, runs at 64 times the PCM rate,
+    // and every frame is decimated to a single PCM sample.
+    if (!i2s.begin(AN_I2S_MODE_IN, sample_rate, n_samples, n_buffers, AN_RESOLUTION_32)) {
+        stop();
+        return 0;
+    }
+    return 1;
+}
+
+bool AdvancedPDM::available() {
+    return pool && pool->writable() && i2s.available();
+}
+
+DMABuffer<Sample> &AdvancedPDM::read() {
+    static DMABuffer<Sample> NULLBUF;
+    if (pool == nullptr) {
+        return NULLBUF;
+    }
+
+    while (!available()) {
+        __WFI();
+    }
+
+    DMABuffer<Sample32> &raw = i2s.read();
+    DMABuffer<Sample> *buf = pool->alloc(DMA_BUFFER_WRITE);
+
+    decimator.decimate(raw.data(), raw.size(), (int16_t *) buf->data());
+
+    buf->clr_flags();
+    buf->timestamp(raw.timestamp());
+    if (raw.get_flags(DMA_BUFFER_DISCONT)) {
+        buf->set_flags(DMA_BUFFER_DISCONT);
+    }
+    buf->set_flags(DMA_BUFFER_READ);
+    raw.release();
+    return *buf;
+}
+
+int AdvancedPDM::stop() {
+    i2s.stop();
+    if (pool) {
+        delete pool;
+        pool = nullptr;
+    }
+    return 1;
+}
@@ -0,0 +1,49 @@
+/*
+  This file is part of the Arduino_AdvancedAnalog library.
+  Copyright (c) 2024 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_PDM_H__
+#define __ADVANCED_PDM_H__
+
+#include "AdvancedAnalog.h"
+#include "AdvancedI2S.h"
+#include "PDMDecimator.h"
+
+// Number of PCM buffers, i.e. how many buffers can be held by the sketch at once.
+#define AN_PDM_PCM_BUFFERS  (4)
+
+class AdvancedPDM {
+    private:
+        AdvancedI2S32 i2s;
+        PDMDecimator decimator;
+        DMAPool<Sample> *pool;
+
+    public:
+        AdvancedPDM(PinName clk, PinName data): i2s(NC, clk, data, NC, NC), pool(nullptr) {
+        }
+        ~AdvancedPDM();
+        int begin(uint32_t sample_rate, size_t n_samples, size_t n_buffers, float gain=1.0f);
+        bool available();
+        SampleBuffer read();
+        int irq_priority(uint32_t priority) {
+            return i2s.irq_priority(priority);
+        }
+        int stop();
+};
+
+#endif // __ADVANCED_PDM_H__
@@ -0,0 +1,453 @@
+/*
+  This file is part of the Arduino_AdvancedAnalog library.
+  Copyright (c) 2024 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Arduino.h"
+#include "HALConfig.h"
+#include "AdvancedSAI.h"
+
+#define SAI1_A  ((int) SAI1_Block_A_BASE)
+#define SAI2_A  ((int) SAI2_Block_A_BASE)
+
+// Number of buffers written before the transmit DMA is started.
+#define SAI_TX_PRIME    (3)
+
+template <typename T>
+struct sai_stream_t {
+    DMAPool<T> *pool;
+    DMABuffer<T> *buf[2];
+    // True if the pool is in non-cacheable memory.
+    bool uncached;
+};
+
+struct sai_descr_t {
+    SAI_HandleTypeDef sai;
+    DMA_HandleTypeDef dma;
+    uint32_t direction;
+    size_t sample_size;
+    size_t n_primed;
+    // NOTE: Only the stream that matches the sample size is used.
+    sai_stream_t<Sample> s16;
+    sai_stream_t<Sample32> s32;
+};
+
+static sai_descr_t sai_descr_all[] = {
+    {{SAI1_Block_A}, {nullptr, {DMA_REQUEST_SAI1_A}}},
+    {{SAI2_Block_A}, {nullptr, {DMA_REQUEST_SAI2_A}}},
+};
+
+static const PinMap PinMap_SAI_FS[] = {
+    {PE_4,  SAI1_A, STM_PIN_DATA(STM_MODE_AF_PP, GPIO_NOPULL, GPIO_AF6_SAI1)},
+    {PD_12, SAI2_A, STM_PIN_DATA(STM_MODE_AF_PP, GPIO_NOPULL, GPIO_AF10_SAI2)},
+    {NC, NC, 0}
+};
+
+static const PinMap PinMap_SAI_SCK[] = {
+    {PE_5,  SAI1_A, STM_PIN_DATA(STM_MODE_AF_PP, GPIO_NOPULL, GPIO_AF6_SAI1)},
+    {PD_13, SAI2_A, STM_PIN_DATA(STM_MODE_AF_PP, GPIO_NOPULL, GPIO_AF10_SAI2)},
+    {NC, NC, 0}
+};
+
+static const PinMap PinMap_SAI_SD[] = {
+    {PE_6,  SAI1_A, STM_PIN_DATA(STM_MODE_AF_PP, GPIO_NOPULL, GPIO_AF6_SAI1)},
+    {PC_1,  SAI1_A, STM_PIN_DATA(STM_MODE_AF_PP, GPIO_NOPULL, GPIO_AF6_SAI1)},
+    {PD_6,  SAI1_A, STM_PIN_DATA(STM_MODE_AF_PP, GPIO_NOPULL, GPIO_AF6_SAI1)},
+    {PD_11, SAI2_A, STM_PIN_DATA(STM_MODE_AF_PP, GPIO_NOPULL, GPIO_AF10_SAI2)},
+    {NC, NC, 0}
+};
+
+static const PinMap PinMap_SAI_MCK[] = {
+    {PE_2,  SAI1_A, STM_PIN_DATA(STM_MODE_AF_PP, GPIO_NOPULL, GPIO_AF6_SAI1)},
+    {PG_7,  SAI1_A, STM_PIN_DATA(STM_MODE_AF_PP, GPIO_NOPULL, GPIO_AF6_SAI1)},
+    {PE_0,  SAI2_A, STM_PIN_DATA(STM_MODE_AF_PP, GPIO_NOPULL, GPIO_AF10_SAI2)},
+    {NC, NC, 0}
+};
+
+template <typename T> static sai_stream_t<T> &sai_stream(sai_descr_t *descr);
+
+template <> sai_stream_t<Sample> &sai_stream<Sample>(sai_descr_t *descr) {
+    return descr->s16;
+}
+
+template <> sai_stream_t<Sample32> &sai_stream<Sample32>(sai_descr_t *descr) {
+    return descr->s32;
+}
+
+static sai_descr_t *sai_descr_get(SAI_Block_TypeDef *sai) {
+    if (sai == SAI1_Block_A) {
+        return &sai_descr_all[0];
+    } else if (sai == SAI2_Block_A) {
+        return &sai_descr_all[1];
+    }
+    return NULL;
+}
+
+template <typename T>
+static void sai_stream_deinit(sai_stream_t<T> &stream, bool dealloc_pool) {
+    for (size_t i=0; i<AN_ARRAY_SIZE(stream.buf); i++) {
+        if (stream.buf[i]) {
+            stream.buf[i]->release();
+            stream.buf[i] = nullptr;
+        }
+    }
+
+    if (dealloc_pool) {
+        if (stream.pool) {
+            hal_dma_pool_delete(stream.pool);
+        }
+        stream.pool = nullptr;
+    } else if (stream.pool) {
+        stream.pool->flush();
+    }
+}
+
+static void sai_descr_deinit(sai_descr_t *descr, bool dealloc_pool) {
+    if (descr != nullptr) {
+        HAL_SAI_DMAStop(&descr->sai);
+        sai_stream_deinit(descr->s16, dealloc_pool);
+        sai_stream_deinit(descr->s32, dealloc_pool);
+        descr->n_primed = 0;
+        if (dealloc_pool) {
+            hal_dma_free(&descr->dma);
+        }
+    }
+}
+
+template <typename T>
+static void sai_tx_cplt(sai_descr_t *descr) {
+    sai_stream_t<T> &tx = sai_stream<T>(descr);
+
+    // NOTE: CT bit is inverted, to get the DMA buffer that's Not currently in use.
+    size_t ct = ! hal_dma_get_ct(&descr->dma);
+
+    // Release the DMA buffer that was just used, dequeue the next one, and update
+    // the next DMA memory address target.
+    if (tx.pool->readable()) {
+        tx.buf[ct]->release();
+        tx.buf[ct] = tx.pool->alloc(DMA_BUFFER_READ);
+        hal_dma_update_memory(&descr->dma, tx.buf[ct]->data());
+    } else {
+        sai_descr_deinit(descr, false);
+    }
+}
+
+template <typename T>
+static void sai_rx_cplt(sai_descr_t *descr) {
+    sai_stream_t<T> &rx = sai_stream<T>(descr);
+
+    // NOTE: CT bit is inverted, to get the DMA buffer that's Not currently in use.
+    size_t ct = ! hal_dma_get_ct(&descr->dma);
+
+    // Update the buffer's timestamp.
+    rx.buf[ct]->timestamp(us_ticker_read());
+
+    // Flush the DMA buffer that was just used, move it to the ready queue, and
+    // allocate a new one.
+    if (rx.pool->writable()) {
+        // Make sure any cached data is discarded.
+        if (!rx.uncached) {
+            rx.buf[ct]->invalidate();
+        }
+        // Move current DMA buffer to ready queue.
+        rx.buf[ct]->release();
+        // Allocate a new free buffer.
+        rx.buf[ct] = rx.pool->alloc(DMA_BUFFER_WRITE);
+        // All TDM slots are interleaved in a single buffer.
+        if (rx.buf[ct]->channels() > 1) {
+            rx.buf[ct]->set_flags(DMA_BUFFER_INTRLVD);
+        }
+    } else {
+        rx.buf[ct]->set_flags(DMA_BUFFER_DISCONT);
+    }
+
+    // Update the next DMA target pointer.
+    // NOTE: If the pool was empty, the same buffer is reused.
+    hal_dma_update_memory(&descr->dma, rx.buf[ct]->data());
+}
+
+static void sai_dma_cplt(DMA_HandleTypeDef *dma) {
+    sai_descr_t *descr = sai_descr_get(((SAI_HandleTypeDef *) dma->Parent)->Instance);
+
+    if (descr == nullptr) {
+        return;
+    }
+
+    if (descr->direction == DMA_PERIPH_TO_MEMORY) {
+        if (descr->sample_size == sizeof(Sample32)) {
+            sai_rx_cplt<Sample32>(descr);
+        } else {
+            sai_rx_cplt<Sample>(descr);
+        }
+    } else {
+        if (descr->sample_size == sizeof(Sample32)) {
+            sai_tx_cplt<Sample32>(descr);
+        } else {
+            sai_tx_cplt<Sample>(descr);
+        }
+    }
+}
+
+template <typename T>
+static int sai_start_dma_transfer(sai_descr_t *descr) {
+    sai_stream_t<T> &stream = sai_stream<T>(descr);
+    bool rx = (descr->direction == DMA_PERIPH_TO_MEMORY);
+
+    for (size_t i=0; i<AN_ARRAY_SIZE(stream.buf); i++) {
+        stream.buf[i] = stream.pool->alloc(rx ? DMA_BUFFER_WRITE : DMA_BUFFER_READ);
+    }
+
+    // Start SAI DMA.
+    HAL_NVIC_DisableIRQ(hal_dma_irqn(&descr->dma));
+    uint8_t *buf = (uint8_t *) stream.buf[0]->data();
+    if (rx) {
+        if (HAL_SAI_Receive_DMA(&descr->sai, buf, stream.buf[0]->size()) != HAL_OK) {
+            return 0;
+        }
+    } else {
+        if (HAL_SAI_Transmit_DMA(&descr->sai, buf, stream.buf[0]->size()) != HAL_OK) {
+            return 0;
+        }
+    }
+    HAL_SAI_DMAPause(&descr->sai);
+
+    // NOTE: The HAL's SAI DMA complete callbacks stop the transfer in any mode other
+    // than circular, so they're replaced before double buffer mode is enabled.
+    descr->dma.XferCpltCallback = sai_dma_cplt;
+
+    // Re/enable DMA double buffer mode.
+    hal_dma_enable_dbm(&descr->dma, stream.buf[0]->data(), stream.buf[1]->data());
+    HAL_NVIC_EnableIRQ(hal_dma_irqn(&descr->dma));
+    HAL_SAI_DMAResume(&descr->sai);
+    return 1;
+}
+
+template <typename T>
+bool AdvancedSAIImpl<T>::available() {
+    if (descr != nullptr && sai_stream<T>(descr).pool) {
+        if (sai_mode == AN_I2S_MODE_IN) {
+            return sai_stream<T>(descr).pool->readable();
+        } else {
+            return sai_stream<T>(descr).pool->writable();
+        }
+    }
+    return false;
+}
+
+template <typename T>
+DMABuffer<T> &AdvancedSAIImpl<T>::read() {
+    static DMABuffer<T> NULLBUF;
+    if (descr && sai_mode == AN_I2S_MODE_IN && sai_stream<T>(descr).pool) {
+        DMAPool<T> *pool = sai_stream<T>(descr).pool;
+        while (!pool->readable()) {
+            __WFI();
+        }
+        return *pool->alloc(DMA_BUFFER_READ);
+    }
+    return NULLBUF;
+}
+
+template <typename T>
+DMABuffer<T> &AdvancedSAIImpl<T>::dequeue() {
+    static DMABuffer<T> NULLBUF;
+    if (descr && sai_mode == AN_I2S_MODE_OUT && sai_stream<T>(descr).pool) {
+        DMAPool<T> *pool = sai_stream<T>(descr).pool;
+        while (!pool->writable()) {
+            __WFI();
+        }
+        return *pool->alloc(DMA_BUFFER_WRITE);
+    }
+    return NULLBUF;
+}
+
+template <typename T>
+void AdvancedSAIImpl<T>::write(DMABuffer<T> &dmabuf) {
+    if (descr == nullptr) {
+        return;
+    }
+
+    // Make sure any cached data is flushed.
+    if (!sai_stream<T>(descr).uncached) {
+        dmabuf.flush();
+    }
+    dmabuf.release();
+
+    if (sai_stream<T>(descr).buf[0] == nullptr && (++descr->n_primed) == SAI_TX_PRIME) {
+        descr->n_primed = 0;
+        sai_start_dma_transfer<T>(descr);
+    }
+}
+
+template <typename T>
+int AdvancedSAIImpl<T>::begin(i2s_mode_t sai_mode, uint32_t sample_rate, size_t n_samples,
+                              size_t n_buffers, size_t n_slots, uint32_t resolution) {
+    bool slave = sai_mode & AN_I2S_MODE_SLAVE;
+    this->sai_mode = (i2s_mode_t) (sai_mode & AN_I2S_MODE_INOUT);
+
+    // Sanity checks. A SAI block has a single data line, so it's either input or output.
+    if (sample_rate < 8000 || sample_rate > 192000 || descr != nullptr ||
+       (this->sai_mode != AN_I2S_MODE_IN && this->sai_mode != AN_I2S_MODE_OUT)) {
+        return 0;
+    }
+
+    // 16-bit slots use 16-bit samples, and 32-bit slots use 32-bit samples. 24-bit data
+    // isn't supported as such: it's received and sent left-aligned in 32-bit samples,
+    // as with I2S, so 24-bit devices use AN_RESOLUTION_32.
+    if ((resolution != AN_RESOLUTION_16 && resolution != AN_RESOLUTION_32) ||
+       ((resolution == AN_RESOLUTION_16) != (sizeof(T) == 2))) {
+        return 0;
+    }
+
+    // The frame can't be longer than 256 bit clocks, and it must be a power of 2 if
+    // MCLK is generated, since the bit clock is then divided down from 256 x Fs.
+    size_t frame_bits = n_slots * sizeof(T) * 8;
+    bool mck_enable = (sai_pins[3] != NC) && !slave;
+    if (n_slots == 0 || n_slots > AN_SAI_MAX_SLOTS || frame_bits > 256 ||
+       (mck_enable && (frame_bits & (frame_bits - 1)))) {
+        return 0;
+    }
+
+    // The buffers must hold a whole number of DMA bursts.
+    if (hal_dma_check_burst(burst, fifo, sizeof(T), n_samples * n_slots * sizeof(T)) < 0) {
+        return 0;
+    }
+
+    // Configure SAI pins.
+    uint32_t sai = NC;
+    const PinMap *sai_pins_map[] = {
+        PinMap_SAI_FS, PinMap_SAI_SCK, PinMap_SAI_SD, PinMap_SAI_MCK
+    };
+
+    for (size_t i=0; i<AN_ARRAY_SIZE(sai_pins); i++) {
+        uint32_t per;
+        if (sai_pins[i] == NC) {
+            continue;
+        }
+        per = pinmap_find_peripheral(sai_pins[i], sai_pins_map[i]);
+        if (per == NC) {
+            return 0;
+        } else if (sai == NC) {
+            sai = per;
+        } else if (sai != per) {
+            return 0;
+        }
+        pinmap_pinout(sai_pins[i], sai_pins_map[i]);
+    }
+
+    descr = sai_descr_get((SAI_Block_TypeDef *) sai);
+    if (descr == nullptr) {
+        return 0;
+    }
+
+    descr->sample_size = sizeof(T);
+    descr->direction = (this->sai_mode == AN_I2S_MODE_IN) ? DMA_PERIPH_TO_MEMORY : DMA_MEMORY_TO_PERIPH;
+    descr->n_primed = 0;
+
+    // Allocate DMA buffer pool. All slots are interleaved in the same buffer.
+    sai_stream_t<T> &stream = sai_stream<T>(descr);
+    hal_dma_arena_t mem = {(uint8_t *) arena, arena_size};
+    stream.pool = hal_dma_pool_new<T>(n_samples, n_slots, n_buffers, memory, &mem);
+    if (stream.pool == nullptr) {
+        descr = nullptr;
+        return 0;
+    }
+    stream.uncached = (memory == AN_DMA_MEM_UNCACHED);
+
+    // Init and config DMA. From here on, failures free the pool and the DMA stream,
+    // so the descriptor can be used again.
+    if (hal_dma_config(&descr->dma, descr->direction, sizeof(T), burst, fifo, priority) != 0) {
+        sai_descr_deinit(descr, true);
+        descr = nullptr;
+        return 0;
+    }
+
+    uint32_t mode;
+    if (this->sai_mode == AN_I2S_MODE_IN) {
+        mode = slave ? SAI_MODESLAVE_RX : SAI_MODEMASTER_RX;
+        __HAL_LINKDMA(&descr->sai, hdmarx, descr->dma);
+    } else {
+        mode = slave ? SAI_MODESLAVE_TX : SAI_MODEMASTER_TX;
+        __HAL_LINKDMA(&descr->sai, hdmatx, descr->dma);
+    }
+
+    // Init and config SAI.
+    uint32_t data_size = (sizeof(T) == 2) ? SAI_PROTOCOL_DATASIZE_16BIT : SAI_PROTOCOL_DATASIZE_32BIT;
+    if (hal_sai_config(&descr->sai, sample_rate, mode, mck_enable, data_size, n_slots) != 0) {
+        sai_descr_deinit(descr, true);
+        descr = nullptr;
+        return 0;
+    }
+
+    if (this->sai_mode == AN_I2S_MODE_IN && !sai_start_dma_transfer<T>(descr)) {
+        sai_descr_deinit(descr, true);
+        descr = nullptr;
+        return 0;
+    }
+    return 1;
+}
+
+template <typename T>
+int AdvancedSAIImpl<T>::dma_burst(uint32_t burst, uint32_t fifo) {
+    // Must be called before begin().
+    if (descr != nullptr || hal_dma_check_burst(burst, fifo, sizeof(T), 0) < 0) {
+        return 0;
+    }
+    this->burst = burst;
+    this->fifo = fifo;
+    return 1;
+}
+
+template <typename T>
+int AdvancedSAIImpl<T>::dma_memory(uint32_t memory, void *arena, size_t size) {
+    // Must be called before begin().
+    if (descr != nullptr || memory > AN_DMA_MEM_UNCACHED ||
+       (memory == AN_DMA_MEM_UNCACHED && arena == nullptr && hal_dma_mem_check() < 0)) {
+        return 0;
+    }
+    this->memory = memory;
+    this->arena = arena;
+    this->arena_size = size;
+    return 1;
+}
+
+template <typename T>
+int AdvancedSAIImpl<T>::irq_priority(uint32_t priority) {
+    if (priority > AN_IRQ_PRIORITY_LOWEST) {
+        return 0;
+    }
+    this->priority = priority;
+    // If the SAI is running, the new priority takes effect immediately.
+    if (descr != nullptr) {
+        hal_dma_set_priority(&descr->dma, priority);
+    }
+    return 1;
+}
+
+template <typename T>
+int AdvancedSAIImpl<T>::stop() {
+    sai_descr_deinit(descr, true);
+    descr = nullptr;
+    return 1;
+}
+
+template <typename T>
+AdvancedSAIImpl<T>::~AdvancedSAIImpl() {
+    sai_descr_deinit(descr, true);
+}
+
+template class AdvancedSAIImpl<Sample>;
+template class AdvancedSAIImpl<Sample32>;
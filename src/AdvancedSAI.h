@@ -0,0 +1,73 @@
+/*
+  This file is part of the Arduino_AdvancedAnalog library.
+  Copyright (c) 2024 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_SAI_H__
+#define __ADVANCED_SAI_H__
+
+#include "AdvancedAnalog.h"
+#include "AdvancedI2S.h"
+
+#define AN_SAI_MAX_SLOTS    (16)
+
+struct sai_descr_t;
+
+template <typename T>
+class AdvancedSAIImpl {
+    private:
+        sai_descr_t *descr;
+        PinName sai_pins[4];
+        i2s_mode_t sai_mode;
+        uint32_t burst;
+        uint32_t fifo;
+        uint32_t memory;
+        void *arena;
+        size_t arena_size;
+        uint32_t priority;
+
+    public:
+        AdvancedSAIImpl(PinName fs, PinName sck, PinName sd, PinName mck):
+            descr(nullptr), sai_pins{fs, sck, sd, mck}, burst(AN_DMA_BURST_SINGLE), fifo(AN_DMA_FIFO_FULL),
+            memory(AN_DMA_MEM_CACHED), arena(nullptr), arena_size(0), priority(AN_IRQ_PRIORITY_HIGHEST) {
+        }
+
+        AdvancedSAIImpl(): descr(nullptr), sai_pins{NC, NC, NC, NC},
+            burst(AN_DMA_BURST_SINGLE), fifo(AN_DMA_FIFO_FULL), memory(AN_DMA_MEM_CACHED),
+            arena(nullptr), arena_size(0), priority(AN_IRQ_PRIORITY_HIGHEST) {
+        }
+
+        ~AdvancedSAIImpl();
+
+        bool available();
+        DMABuffer<T> &read();
+        DMABuffer<T> &dequeue();
+        void write(DMABuffer<T> &dmabuf);
+        int begin(i2s_mode_t sai_mode, uint32_t sample_rate, size_t n_samples, size_t n_buffers, size_t n_slots,
+                  uint32_t resolution=(sizeof(T) == 2) ? AN_RESOLUTION_16 : AN_RESOLUTION_32);
+        int dma_burst(uint32_t burst, uint32_t fifo=AN_DMA_FIFO_FULL);
+        int dma_memory(uint32_t memory, void *arena=nullptr, size_t size=0);
+        int irq_priority(uint32_t priority);
+        int stop();
+};
+
+// 16-bit TDM slots, using the default Sample type.
+typedef AdvancedSAIImpl<Sample>     AdvancedSAI;
+// 24-bit and 32-bit TDM slots, using 32-bit samples.
+typedef AdvancedSAIImpl<Sample32>   AdvancedSAI32;
+
+#endif // __ADVANCED_SAI_H__
@@ -0,0 +1,102 @@
+/*
+  This file is part of the Arduino_AdvancedAnalog library.
+  Copyright (c) 2024 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "Arduino.h"
+#include "HALConfig.h"
+#include "AdvancedSync.h"
+
+int AdvancedSync::add(AdvancedADC &adc) {
+    // Must be called before begin(), and an ADC can only be in one group.
+    if (n_adc == AN_SYNC_MAX_ADC || adc.sync_hold) {
+        return 0;
+    }
+    adc.sync_hold = true;
+    this->adc[n_adc++] = &adc;
+    return 1;
+}
+
+int AdvancedSync::add(AdvancedDAC &dac) {
+    // Must be called before begin(), and a DAC can only be in one group.
+    if (n_dac == AN_SYNC_MAX_DAC || dac.sync_hold) {
+        return 0;
+    }
+    dac.sync_hold = true;
+    this->dac[n_dac++] = &dac;
+    return 1;
+}
+
+int AdvancedSync::start() {
+    TIM_HandleTypeDef *tim[AN_SYNC_MAX_ADC + AN_SYNC_MAX_DAC];
+    size_t n_tim = 0;
+
+    // All members must be ready, and held by this group.
+    for (size_t i=0; i<n_adc; i++) {
+        if (!adc[i]->sync_hold || (tim[n_tim++] = adc[i]->sync_timer()) == nullptr) {
+            return 0;
+        }
+    }
+
+    for (size_t i=0; i<n_dac; i++) {
+        if (!dac[i]->sync_hold || (tim[n_tim++] = dac[i]->sync_timer()) == nullptr) {
+            return 0;
+        }
+    }
+
+    // On failure, the timers are stopped and back in standalone mode, and the members
+    // stay held, so start() can be retried.
+    if (n_tim == 0 || hal_tim_sync(tim, n_tim) < 0) {
+        return 0;
+    }
+
+    // The members run on their own from now on, so a DAC that underruns is
+    // restarted as usual, unsynchronised.
+    for (size_t i=0; i<n_adc; i++) {
+        adc[i]->sync_hold = false;
+    }
+
+    for (size_t i=0; i<n_dac; i++) {
+        dac[i]->sync_hold = false;
+    }
+    return 1;
+}
+
+int AdvancedSync::stop() {
+    // Stop all members, and hold them again for the next start().
+    for (size_t i=0; i<n_adc; i++) {
+        adc[i]->stop();
+        adc[i]->sync_hold = true;
+    }
+
+    for (size_t i=0; i<n_dac; i++) {
+        dac[i]->stop();
+        dac[i]->sync_hold = true;
+    }
+    return 1;
+}
+
+AdvancedSync::~AdvancedSync() {
+    for (size_t i=0; i<n_adc; i++) {
+        adc[i]->sync_hold = false;
+    }
+
+    for (size_t i=0; i<n_dac; i++) {
+        dac[i]->sync_hold = false;
+    }
+}
@@ -0,0 +1,54 @@
+/*
+  This file is part of the Arduino_AdvancedAnalog library.
+  Copyright (c) 2024 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_SYNC_H__
+#define __ADVANCED_SYNC_H__
+
+#include "AdvancedADC.h"
+#include "AdvancedADCFixed.h"
+#include "AdvancedDAC.h"
+
+#define AN_SYNC_MAX_ADC     (3)
+#define AN_SYNC_MAX_DAC     (2)
+
+// Starts a group of ADCs and DACs on the same hardware event. One of the trigger
+// timers is the master, and the others are slaved to its trigger output, so all
+// streams start with a fixed offset between them.
+class AdvancedSync {
+    private:
+        size_t n_adc;
+        size_t n_dac;
+        AdvancedADC *adc[AN_SYNC_MAX_ADC];
+        AdvancedDAC *dac[AN_SYNC_MAX_DAC];
+
+    public:
+        AdvancedSync(): n_adc(0), n_dac(0) {
+        }
+        ~AdvancedSync();
+        int add(AdvancedADC &adc);
+        int add(AdvancedDAC &dac);
+        template <size_t N_CHANNELS, size_t N_SAMPLES, size_t N_BUFFERS, typename T>
+        int add(AdvancedADCFixed<N_CHANNELS, N_SAMPLES, N_BUFFERS, T> &adc) {
+            return add(adc.adc);
+        }
+        int start();
+        int stop();
+};
+
+#endif // __ADVANCED_SYNC_H__
@@ -21,8 +21,16 @@
 #define __ARDUINO_ADVANCED_ANALOG_H__
 
 #include "AdvancedADC.h"
+#include "AdvancedADCFixed.h"
 #include "AdvancedDAC.h"
 #include "AdvancedI2S.h"
+#include "AdvancedSAI.h"
+#include "AdvancedPDM.h"
+#include "AdvancedSync.h"
 #include "WavReader.h"
+#include "WavImage.h"
+#include "WavWriter.h"
+#include "DDSGenerator.h"
+#include "SampleMixer.h"
 
 #endif // __ARDUINO_ADVANCED_ANALOG_H__
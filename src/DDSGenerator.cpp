@@ -0,0 +1,147 @@
+/*
+  This file is part of the Arduino_AdvancedAnalog library.
+  Copyright (c) 2024 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Arduino.h"
+#include "DDSGenerator.h"
+
+// Amplitude ramp fractional bits.
+#define DDS_AMP_FRAC    (12)
+
+// Quarter-wave symmetry is not used, so the interpolation can run without branches.
+// The extra entry at the end is a copy of the first one (wrap-around guard).
+static int16_t DDS_SINE_LUT[AN_DDS_LUT_SIZE + 1];
+
+static uint32_t DDS_RES_LUT[] = {
+    8, 10, 12, 14, 16
+};
+
+template <dds_waveform_t W>
+static inline int32_t dds_sample(uint32_t phase) {
+    if (W == AN_WAVE_SINE) {
+        // The upper bits index the table, and the next 16 bits interpolate linearly.
+        uint32_t idx = phase >> (32 - AN_DDS_LUT_BITS);
+        int32_t frac = (phase >> (16 - AN_DDS_LUT_BITS)) & 0xFFFF;
+        int32_t s0 = DDS_SINE_LUT[idx];
+        int32_t s1 = DDS_SINE_LUT[idx + 1];
+        return s0 + (((s1 - s0) * frac) >> 16);
+    } else if (W == AN_WAVE_TRIANGLE) {
+        // Fold the sawtooth around zero: 0 -> -32767, 0.5 -> 32767, 1 -> -32767.
+        int32_t saw = (int32_t) (phase >> 16) - 32768;
+        return 32767 - ((saw ^ (saw >> 31)) << 1);
+    } else if (W == AN_WAVE_SQUARE) {
+        return (phase & 0x80000000U) ? -32767 : 32767;
+    } else {
+        return (int32_t) (phase >> 16) - 32768;
+    }
+}
+
+template <dds_waveform_t W>
+static void dds_fill(Sample *data, size_t n_samples, size_t n_channels, uint32_t &phase,
+                     uint32_t phase_inc, int32_t amp, int32_t amp_step, uint32_t shift) {
+    // NOTE: amp is Q15 with DDS_AMP_FRAC extra fractional bits, so the amplitude ramp
+    // can be spread over the whole block without zipper noise.
+    if (n_channels == 1) {
+        for (size_t i=0; i<n_samples; i++) {
+            int32_t s = (dds_sample<W>(phase) * (amp >> DDS_AMP_FRAC)) >> 15;
+            data[i] = (Sample) ((uint32_t) (s + 32768) >> shift);
+            phase += phase_inc;
+            amp += amp_step;
+        }
+    } else {
+        for (size_t i=0; i<n_samples; i++, data += n_channels) {
+            int32_t s = (dds_sample<W>(phase) * (amp >> DDS_AMP_FRAC)) >> 15;
+            Sample v = (Sample) ((uint32_t) (s + 32768) >> shift);
+            for (size_t c=0; c<n_channels; c++) {
+                data[c] = v;
+            }
+            phase += phase_inc;
+            amp += amp_step;
+        }
+    }
+}
+
+int DDSGenerator::begin(uint32_t resolution, uint32_t sample_rate, dds_waveform_t waveform) {
+    // Sanity checks.
+    if (resolution >= AN_ARRAY_SIZE(DDS_RES_LUT) || sample_rate == 0) {
+        return 0;
+    }
+
+    // The sine table is shared by all generators, and only has to be built once.
+    if (DDS_SINE_LUT[AN_DDS_LUT_SIZE / 4] == 0) {
+        for (size_t i=0; i<AN_DDS_LUT_SIZE; i++) {
+            DDS_SINE_LUT[i] = (int16_t) lroundf(sinf(2.0f * PI * i / AN_DDS_LUT_SIZE) * 32767.0f);
+        }
+        DDS_SINE_LUT[AN_DDS_LUT_SIZE] = DDS_SINE_LUT[0];
+    }
+
+    fs = sample_rate;
+    shift = 16 - DDS_RES_LUT[resolution];
+    phase = 0;
+    phase_inc = next_phase_inc = 0;
+    amp = next_amp = (32768 << DDS_AMP_FRAC);
+    wave = next_wave = waveform;
+    return 1;
+}
+
+void DDSGenerator::waveform(dds_waveform_t waveform) {
+    next_wave = waveform;
+}
+
+void DDSGenerator::frequency(float frequency) {
+    if (fs == 0 || frequency < 0.0f || frequency >= (fs / 2.0f)) {
+        return;
+    }
+    // The phase increment is a 32-bit fraction of the sample rate.
+    next_phase_inc = (uint32_t) ((double) frequency * 4294967296.0 / fs);
+}
+
+void DDSGenerator::amplitude(float amplitude) {
+    amplitude = constrain(amplitude, 0.0f, 1.0f);
+    next_amp = ((int32_t) (amplitude * 32768.0f)) << DDS_AMP_FRAC;
+}
+
+void DDSGenerator::generate(Sample *data, size_t n_samples, size_t n_channels) {
+    if (fs == 0 || data == nullptr || n_samples == 0) {
+        return;
+    }
+
+    // Any parameter changes are only applied at block boundaries. The phase is kept
+    // continuous across frequency changes, and the amplitude is ramped over the block,
+    // so neither of them causes a discontinuity in the output.
+    wave = next_wave;
+    phase_inc = next_phase_inc;
+    int32_t target = next_amp;
+    int32_t amp_step = (target - amp) / (int32_t) n_samples;
+
+    switch (wave) {
+        case AN_WAVE_SINE:
+            dds_fill<AN_WAVE_SINE>(data, n_samples, n_channels, phase, phase_inc, amp, amp_step, shift);
+            break;
+        case AN_WAVE_TRIANGLE:
+            dds_fill<AN_WAVE_TRIANGLE>(data, n_samples, n_channels, phase, phase_inc, amp, amp_step, shift);
+            break;
+        case AN_WAVE_SQUARE:
+            dds_fill<AN_WAVE_SQUARE>(data, n_samples, n_channels, phase, phase_inc, amp, amp_step, shift);
+            break;
+        default:
+            dds_fill<AN_WAVE_SAWTOOTH>(data, n_samples, n_channels, phase, phase_inc, amp, amp_step, shift);
+            break;
+    }
+    amp = target;
+}
@@ -0,0 +1,64 @@
+/*
+  This file is part of the Arduino_AdvancedAnalog library.
+  Copyright (c) 2024 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_DDS_GENERATOR_H__
+#define __ADVANCED_DDS_GENERATOR_H__
+
+#include "AdvancedAnalog.h"
+
+#define AN_DDS_LUT_BITS     (8)
+#define AN_DDS_LUT_SIZE     (1U << AN_DDS_LUT_BITS)
+
+typedef enum {
+    AN_WAVE_SINE        = 0U,
+    AN_WAVE_TRIANGLE    = 1U,
+    AN_WAVE_SQUARE      = 2U,
+    AN_WAVE_SAWTOOTH    = 3U,
+} dds_waveform_t;
+
+class DDSGenerator {
+    private:
+        uint32_t fs;
+        uint32_t shift;
+        uint32_t phase;
+        uint32_t phase_inc;
+        int32_t amp;
+        dds_waveform_t wave;
+        volatile uint32_t next_phase_inc;
+        volatile int32_t next_amp;
+        volatile dds_waveform_t next_wave;
+
+    public:
+        DDSGenerator(): fs(0), shift(0), phase(0), phase_inc(0), amp(0), wave(AN_WAVE_SINE),
+            next_phase_inc(0), next_amp(0), next_wave(AN_WAVE_SINE) {
+        }
+        int begin(uint32_t resolution, uint32_t sample_rate, dds_waveform_t waveform=AN_WAVE_SINE);
+        void waveform(dds_waveform_t waveform);
+        void frequency(float frequency);
+        void amplitude(float amplitude);
+        void generate(Sample *data, size_t n_samples, size_t n_channels=1);
+        void generate(SampleBuffer buf) {
+            generate(buf.data(), buf.size() / buf.channels(), buf.channels());
+        }
+        size_t resolution() {
+            return 16 - shift;
+        }
+};
+
+#endif // __ADVANCED_DDS_GENERATOR_H__
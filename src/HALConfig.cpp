@@ -29,12 +29,16 @@ static uint32_t hal_tim_freq(TIM_HandleTypeDef *tim) {
     }
 }
 
-int hal_tim_config(TIM_HandleTypeDef *tim, uint32_t t_freq) {
+static void hal_tim_calc(TIM_HandleTypeDef *tim, uint32_t t_freq, uint32_t *period, uint32_t *prescaler) {
     uint32_t t_clk = hal_tim_freq(tim);
     uint32_t t_div = ((t_clk / t_freq) > 0xFFFF) ? 64000 : (t_freq * 2);
 
-    tim->Init.Period                = (t_div / t_freq) - 1;
-    tim->Init.Prescaler             = (t_clk / t_div ) - 1;
+    *period     = (t_div / t_freq) - 1;
+    *prescaler  = (t_clk / t_div ) - 1;
+}
+
+int hal_tim_config(TIM_HandleTypeDef *tim, uint32_t t_freq) {
+    hal_tim_calc(tim, t_freq, &tim->Init.Period, &tim->Init.Prescaler);
     tim->Init.CounterMode           = TIM_COUNTERMODE_UP;
     tim->Init.ClockDivision         = TIM_CLOCKDIVISION_DIV1;
     tim->Init.RepetitionCounter     = 0;
@@ -57,6 +61,8 @@ int hal_tim_config(TIM_HandleTypeDef *tim, uint32_t t_freq) {
         __HAL_RCC_TIM5_CLK_ENABLE();
     } else if (tim->Instance == TIM6) {
         __HAL_RCC_TIM6_CLK_ENABLE();
+    } else if (tim->Instance == TIM8) {
+        __HAL_RCC_TIM8_CLK_ENABLE();
     }
 
     // Init and config the timer.
@@ -68,7 +74,473 @@ int hal_tim_config(TIM_HandleTypeDef *tim, uint32_t t_freq) {
     return 0;
 }
 
-int hal_dma_config(DMA_HandleTypeDef *dma, IRQn_Type irqn, uint32_t direction) {
+int hal_tim_set_freq(TIM_HandleTypeDef *tim, uint32_t t_freq) {
+    uint32_t period, prescaler;
+    hal_tim_calc(tim, t_freq, &period, &prescaler);
+
+    // NOTE: Both PSC and ARR (with ARPE set) are preloaded, so the new values are
+    // only transferred to the shadow registers on the next update event, and the
+    // timer keeps running without being stopped or reset.
+    tim->Init.Period    = period;
+    tim->Init.Prescaler = prescaler;
+    __HAL_TIM_SET_PRESCALER(tim, prescaler);
+    __HAL_TIM_SET_AUTORELOAD(tim, period);
+
+    // If the timer is stopped, force an update event to load the new values now.
+    if (!(tim->Instance->CR1 & TIM_CR1_CEN)) {
+        tim->Instance->EGR = TIM_EGR_UG;
+    }
+    return 0;
+}
+
+// Internal trigger connections of the ADC and DAC trigger timers, i.e. the timer
+// whose TRGO drives each of the slave's ITR0 to ITR3 inputs (RM0433 TIMx internal
+// trigger connection tables).
+static const struct {
+    TIM_TypeDef *slave;
+    TIM_TypeDef *itr[4];
+} TIM_ITR_LUT[] = {
+    {TIM1, {TIM15, TIM2, TIM3, TIM4}},
+    {TIM2, {TIM1,  TIM8, TIM3, TIM4}},
+    {TIM3, {TIM1,  TIM2, TIM15, TIM4}},
+    {TIM4, {TIM1,  TIM2, TIM3, TIM8}},
+    {TIM5, {TIM1,  TIM8, TIM3, TIM4}},
+};
+
+static uint32_t TIM_ITR_TS_LUT[] = {
+    TIM_TS_ITR0, TIM_TS_ITR1, TIM_TS_ITR2, TIM_TS_ITR3
+};
+
+static int hal_tim_itr(TIM_TypeDef *slave, TIM_TypeDef *master) {
+    for (size_t i=0; i<AN_ARRAY_SIZE(TIM_ITR_LUT); i++) {
+        if (TIM_ITR_LUT[i].slave == slave) {
+            for (size_t j=0; j<AN_ARRAY_SIZE(TIM_ITR_LUT[i].itr); j++) {
+                if (TIM_ITR_LUT[i].itr[j] == master) {
+                    return j;
+                }
+            }
+        }
+    }
+    return -1;
+}
+
+static bool hal_tim_is_master(TIM_HandleTypeDef **tim, size_t n_tim, TIM_TypeDef *master) {
+    for (size_t i=0; i<n_tim; i++) {
+        if (tim[i]->Instance != master && hal_tim_itr(tim[i]->Instance, master) < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void hal_tim_sync_abort(TIM_HandleTypeDef **tim, size_t n_tim, TIM_HandleTypeDef *master) {
+    // Stop all timers, and switch the slaves back to standalone mode, so the group can
+    // be started again, or its members started on their own.
+    HAL_TIM_Base_Stop(master);
+    for (size_t i=0; i<n_tim; i++) {
+        if (tim[i] != master) {
+            tim[i]->Instance->SMCR &= ~(TIM_SMCR_SMS | TIM_SMCR_TS);
+            HAL_TIM_Base_Stop(tim[i]);
+        }
+    }
+}
+
+int hal_tim_sync(TIM_HandleTypeDef **tim, size_t n_tim) {
+    static TIM_HandleTypeDef tim_spare = {TIM8};
+    TIM_HandleTypeDef *master = nullptr;
+
+    // Find a master, i.e. a timer that all the other timers can be triggered from.
+    for (size_t i=0; i<n_tim && master == nullptr; i++) {
+        if (hal_tim_is_master(tim, n_tim, tim[i]->Instance)) {
+            master = tim[i];
+        }
+    }
+
+    // The only set of timers without one is TIM2 and TIM5, which are both slaved
+    // to TIM8 instead. TIM8 isn't used by the library, and it's stopped once the
+    // slaves have started.
+    if (master == nullptr) {
+        if (!hal_tim_is_master(tim, n_tim, TIM8) || hal_tim_config(&tim_spare, 1000000) < 0) {
+            return -1;
+        }
+        master = &tim_spare;
+    }
+
+    // Load all counters with their auto-reload value, so each timer's first update event
+    // occurs one tick after it starts, then set the slaves to start on the master's TRGO.
+    __HAL_TIM_SET_COUNTER(master, __HAL_TIM_GET_AUTORELOAD(master));
+    for (size_t i=0; i<n_tim; i++) {
+        if (tim[i] == master) {
+            continue;
+        }
+        __HAL_TIM_SET_COUNTER(tim[i], __HAL_TIM_GET_AUTORELOAD(tim[i]));
+        TIM_SlaveConfigTypeDef sConfig = {0};
+        sConfig.SlaveMode       = TIM_SLAVEMODE_TRIGGER;
+        sConfig.InputTrigger    = TIM_ITR_TS_LUT[hal_tim_itr(tim[i]->Instance, master->Instance)];
+        if (HAL_TIM_SlaveConfigSynchro(tim[i], &sConfig) != HAL_OK) {
+            hal_tim_sync_abort(tim, n_tim, master);
+            return -1;
+        }
+    }
+
+    // Start the master. Its first update event triggers the first conversion of its own
+    // peripheral, if any, and starts all the slaves.
+    if (HAL_TIM_Base_Start(master) != HAL_OK) {
+        hal_tim_sync_abort(tim, n_tim, master);
+        return -1;
+    }
+
+    // Wait for the slaves to start.
+    for (size_t i=0; i<n_tim; i++) {
+        for (uint32_t start = HAL_GetTick(); tim[i] != master && !(tim[i]->Instance->CR1 & TIM_CR1_CEN); ) {
+            if ((HAL_GetTick() - start) > 2) {
+                hal_tim_sync_abort(tim, n_tim, master);
+                return -1;
+            }
+        }
+    }
+
+    // Once started, the slaves keep running on their own, so they're switched back to
+    // standalone mode, to be stopped and restarted as usual.
+    for (size_t i=0; i<n_tim; i++) {
+        if (tim[i] != master) {
+            tim[i]->Instance->SMCR &= ~(TIM_SMCR_SMS | TIM_SMCR_TS);
+        }
+    }
+
+    if (master == &tim_spare) {
+        HAL_TIM_Base_Stop(&tim_spare);
+    }
+    return 0;
+}
+
+static uint32_t DMA_BURST_LUT[] = {
+    DMA_MBURST_SINGLE, DMA_MBURST_INC4, DMA_MBURST_INC8, DMA_MBURST_INC16
+};
+
+static uint32_t DMA_FIFO_LUT[] = {
+    DMA_FIFO_THRESHOLD_1QUARTERFULL, DMA_FIFO_THRESHOLD_HALFFULL,
+    DMA_FIFO_THRESHOLD_3QUARTERSFULL, DMA_FIFO_THRESHOLD_FULL
+};
+
+// DMA streams, and the handles they're allocated to.
+typedef struct {
+    DMA_Stream_TypeDef *stream;
+    IRQn_Type irqn;
+    DMA_HandleTypeDef *dma;
+} hal_dma_stream_t;
+
+static hal_dma_stream_t dma_streams[] = {
+    {DMA1_Stream0, DMA1_Stream0_IRQn, nullptr}, {DMA1_Stream1, DMA1_Stream1_IRQn, nullptr},
+    {DMA1_Stream2, DMA1_Stream2_IRQn, nullptr}, {DMA1_Stream3, DMA1_Stream3_IRQn, nullptr},
+    {DMA1_Stream4, DMA1_Stream4_IRQn, nullptr}, {DMA1_Stream5, DMA1_Stream5_IRQn, nullptr},
+    {DMA1_Stream6, DMA1_Stream6_IRQn, nullptr}, {DMA1_Stream7, DMA1_Stream7_IRQn, nullptr},
+    {DMA2_Stream0, DMA2_Stream0_IRQn, nullptr}, {DMA2_Stream1, DMA2_Stream1_IRQn, nullptr},
+    {DMA2_Stream2, DMA2_Stream2_IRQn, nullptr}, {DMA2_Stream3, DMA2_Stream3_IRQn, nullptr},
+    {DMA2_Stream4, DMA2_Stream4_IRQn, nullptr}, {DMA2_Stream5, DMA2_Stream5_IRQn, nullptr},
+    {DMA2_Stream6, DMA2_Stream6_IRQn, nullptr}, {DMA2_Stream7, DMA2_Stream7_IRQn, nullptr},
+};
+
+static void hal_dma_irq_handler(size_t i) {
+    if (dma_streams[i].dma) {
+        HAL_DMA_IRQHandler(dma_streams[i].dma);
+    }
+}
+
+extern "C" {
+
+#if (AN_DMA_STREAM_MASK & (1U << 0))
+void DMA1_Stream0_IRQHandler() {
+    hal_dma_irq_handler(0);
+}
+#endif
+
+#if (AN_DMA_STREAM_MASK & (1U << 1))
+void DMA1_Stream1_IRQHandler() {
+    hal_dma_irq_handler(1);
+}
+#endif
+
+#if (AN_DMA_STREAM_MASK & (1U << 2))
+void DMA1_Stream2_IRQHandler() {
+    hal_dma_irq_handler(2);
+}
+#endif
+
+#if (AN_DMA_STREAM_MASK & (1U << 3))
+void DMA1_Stream3_IRQHandler() {
+    hal_dma_irq_handler(3);
+}
+#endif
+
+#if (AN_DMA_STREAM_MASK & (1U << 4))
+void DMA1_Stream4_IRQHandler() {
+    hal_dma_irq_handler(4);
+}
+#endif
+
+#if (AN_DMA_STREAM_MASK & (1U << 5))
+void DMA1_Stream5_IRQHandler() {
+    hal_dma_irq_handler(5);
+}
+#endif
+
+#if (AN_DMA_STREAM_MASK & (1U << 6))
+void DMA1_Stream6_IRQHandler() {
+    hal_dma_irq_handler(6);
+}
+#endif
+
+#if (AN_DMA_STREAM_MASK & (1U << 7))
+void DMA1_Stream7_IRQHandler() {
+    hal_dma_irq_handler(7);
+}
+#endif
+
+#if (AN_DMA_STREAM_MASK & (1U << 8))
+void DMA2_Stream0_IRQHandler() {
+    hal_dma_irq_handler(8);
+}
+#endif
+
+#if (AN_DMA_STREAM_MASK & (1U << 9))
+void DMA2_Stream1_IRQHandler() {
+    hal_dma_irq_handler(9);
+}
+#endif
+
+#if (AN_DMA_STREAM_MASK & (1U << 10))
+void DMA2_Stream2_IRQHandler() {
+    hal_dma_irq_handler(10);
+}
+#endif
+
+#if (AN_DMA_STREAM_MASK & (1U << 11))
+void DMA2_Stream3_IRQHandler() {
+    hal_dma_irq_handler(11);
+}
+#endif
+
+#if (AN_DMA_STREAM_MASK & (1U << 12))
+void DMA2_Stream4_IRQHandler() {
+    hal_dma_irq_handler(12);
+}
+#endif
+
+#if (AN_DMA_STREAM_MASK & (1U << 13))
+void DMA2_Stream5_IRQHandler() {
+    hal_dma_irq_handler(13);
+}
+#endif
+
+#if (AN_DMA_STREAM_MASK & (1U << 14))
+void DMA2_Stream6_IRQHandler() {
+    hal_dma_irq_handler(14);
+}
+#endif
+
+#if (AN_DMA_STREAM_MASK & (1U << 15))
+void DMA2_Stream7_IRQHandler() {
+    hal_dma_irq_handler(15);
+}
+#endif
+
+} // extern C
+
+static int hal_dma_alloc(DMA_HandleTypeDef *dma) {
+    int free[2] = {-1, -1};
+    size_t n_used[2] = {0, 0};
+    for (size_t i=0; i<AN_ARRAY_SIZE(dma_streams); i++) {
+        if (dma_streams[i].dma == dma) {
+            // Already allocated.
+            return 0;
+        }
+        if (!(AN_DMA_STREAM_MASK & (1U << i))) {
+            continue;
+        }
+        if (dma_streams[i].dma != nullptr) {
+            n_used[i / 8]++;
+        } else if (free[i / 8] < 0) {
+            free[i / 8] = i;
+        }
+    }
+
+    // Balance the load: use the controller with the fewest streams in use. The request
+    // line is routed to the stream by the DMAMUX, when the stream is initialized.
+    size_t c = (free[0] < 0 || (free[1] >= 0 && n_used[1] < n_used[0])) ? 1 : 0;
+    if (free[c] < 0) {
+        return -1;
+    }
+    dma_streams[free[c]].dma = dma;
+    dma->Instance = dma_streams[free[c]].stream;
+    return 0;
+}
+
+void hal_dma_free(DMA_HandleTypeDef *dma) {
+    for (size_t i=0; i<AN_ARRAY_SIZE(dma_streams); i++) {
+        if (dma_streams[i].dma == dma) {
+            HAL_NVIC_DisableIRQ(dma_streams[i].irqn);
+            HAL_DMA_DeInit(dma);
+            dma_streams[i].dma = nullptr;
+        }
+    }
+}
+
+IRQn_Type hal_dma_irqn(DMA_HandleTypeDef *dma) {
+    // NOTE: Only valid once the handle has been configured, which allocates its stream.
+    for (size_t i=0; i<AN_ARRAY_SIZE(dma_streams); i++) {
+        if (dma_streams[i].stream == dma->Instance) {
+            return dma_streams[i].irqn;
+        }
+    }
+    return dma_streams[0].irqn;
+}
+
+void hal_dma_set_priority(DMA_HandleTypeDef *dma, uint32_t priority) {
+    // Streams that aren't allocated get their priority when they're configured.
+    for (size_t i=0; i<AN_ARRAY_SIZE(dma_streams); i++) {
+        if (dma_streams[i].dma == dma) {
+            HAL_NVIC_SetPriority(dma_streams[i].irqn, priority, 0);
+        }
+    }
+}
+
+// Blocks allocated from the non-cacheable region, sorted by address.
+typedef struct {
+    uint8_t *mem;
+    size_t size;
+    const void *owner;
+} hal_dma_block_t;
+
+static hal_dma_block_t dma_blocks[AN_DMA_NC_BLOCKS];
+static size_t dma_n_blocks = 0;
+
+int hal_dma_mem_check() {
+    // D2 SRAM (also mapped at 0x10000000 for the M4) holds the M4 core's firmware, so
+    // it can't be claimed if the M4 has been started, or boots with the M7.
+    if (AN_DMA_NC_BASE < (D2_AHBSRAM_BASE + 0x48000UL) && (AN_DMA_NC_BASE + AN_DMA_NC_SIZE) > D2_AHBSRAM_BASE) {
+        #if defined(RCC_GCR_BOOT_C2) && defined(FLASH_OPTSR_BCM4)
+        if ((RCC->GCR & RCC_GCR_BOOT_C2) || (FLASH->OPTSR_CUR & FLASH_OPTSR_BCM4)) {
+            return -1;
+        }
+        #endif
+    }
+    return 0;
+}
+
+static void hal_dma_mem_init() {
+    static bool initialized = false;
+    if (initialized) {
+        return;
+    }
+
+    // Make sure the region's SRAM is clocked.
+    __HAL_RCC_D2SRAM1_CLK_ENABLE();
+    __HAL_RCC_D2SRAM2_CLK_ENABLE();
+    __HAL_RCC_D2SRAM3_CLK_ENABLE();
+
+    // Configure the region as normal, non-cacheable memory. The region size is encoded
+    // as log2(size) - 1.
+    MPU_Region_InitTypeDef region = {0};
+    region.Enable           = MPU_REGION_ENABLE;
+    region.Number           = AN_DMA_NC_MPU_REGION;
+    region.BaseAddress      = AN_DMA_NC_BASE;
+    region.Size             = __builtin_ctz(AN_DMA_NC_SIZE) - 1;
+    region.SubRegionDisable = 0x00;
+    region.TypeExtField     = MPU_TEX_LEVEL1;
+    region.AccessPermission = MPU_REGION_FULL_ACCESS;
+    region.DisableExec      = MPU_INSTRUCTION_ACCESS_DISABLE;
+    region.IsShareable      = MPU_ACCESS_NOT_SHAREABLE;
+    region.IsCacheable      = MPU_ACCESS_NOT_CACHEABLE;
+    region.IsBufferable     = MPU_ACCESS_NOT_BUFFERABLE;
+
+    // Write back and drop any lines that were cached from the region before.
+    SCB_CleanInvalidateDCache_by_Addr((uint32_t *) AN_DMA_NC_BASE, AN_DMA_NC_SIZE);
+    HAL_MPU_Disable();
+    HAL_MPU_ConfigRegion(&region);
+    HAL_MPU_Enable(MPU_PRIVILEGED_DEFAULT);
+    initialized = true;
+}
+
+void *hal_dma_mem_alloc(size_t size) {
+    if (dma_n_blocks == AN_ARRAY_SIZE(dma_blocks) || size == 0 || hal_dma_mem_check() < 0) {
+        return nullptr;
+    }
+    hal_dma_mem_init();
+
+    // First fit. Blocks are aligned to the cache line size, like heap DMAPool memory.
+    size = (size + __SCB_DCACHE_LINE_SIZE - 1) & ~(__SCB_DCACHE_LINE_SIZE - 1);
+    uint8_t *mem = (uint8_t *) AN_DMA_NC_BASE;
+    size_t i = 0;
+    for (; i<dma_n_blocks; i++) {
+        if ((size_t) (dma_blocks[i].mem - mem) >= size) {
+            break;
+        }
+        mem = dma_blocks[i].mem + dma_blocks[i].size;
+    }
+
+    if (mem + size > (uint8_t *) AN_DMA_NC_BASE + AN_DMA_NC_SIZE) {
+        return nullptr;
+    }
+
+    memmove(&dma_blocks[i + 1], &dma_blocks[i], (dma_n_blocks - i) * sizeof(hal_dma_block_t));
+    dma_blocks[i] = {mem, size, nullptr};
+    dma_n_blocks++;
+    return mem;
+}
+
+void hal_dma_mem_bind(void *mem, const void *owner) {
+    for (size_t i=0; i<dma_n_blocks; i++) {
+        if (dma_blocks[i].mem == mem) {
+            dma_blocks[i].owner = owner;
+        }
+    }
+}
+
+void hal_dma_mem_free(const void *ptr) {
+    // Memory that wasn't allocated from the region (e.g. heap pools) is ignored.
+    for (size_t i=0; ptr && i<dma_n_blocks; i++) {
+        if (dma_blocks[i].mem == ptr || dma_blocks[i].owner == ptr) {
+            dma_n_blocks--;
+            memmove(&dma_blocks[i], &dma_blocks[i + 1], (dma_n_blocks - i) * sizeof(hal_dma_block_t));
+            return;
+        }
+    }
+}
+
+int hal_dma_check_burst(uint32_t burst, uint32_t fifo, size_t data_size, size_t n_bytes) {
+    if (burst >= AN_ARRAY_SIZE(DMA_BURST_LUT) || fifo >= AN_ARRAY_SIZE(DMA_FIFO_LUT)) {
+        return -1;
+    }
+
+    if (burst == AN_DMA_BURST_SINGLE) {
+        return 0;
+    }
+
+    // Memory bursts are read from/written to the FIFO, so the FIFO threshold must hold a
+    // whole number of bursts, and the buffers must hold a whole number of bursts too.
+    // Bursts must not cross a 1KB boundary, which holds for buffers aligned to the burst
+    // size, like the DMAPool buffers (aligned to the cache line size).
+    size_t burst_bytes = (2U << burst) * data_size;
+    size_t fifo_bytes = (fifo + 1) * 4;
+    if (burst_bytes > fifo_bytes || (fifo_bytes % burst_bytes) || (n_bytes % burst_bytes)) {
+        return -1;
+    }
+    return 0;
+}
+
+int hal_dma_config(DMA_HandleTypeDef *dma, uint32_t direction, size_t data_size,
+                   uint32_t burst, uint32_t fifo, uint32_t priority) {
+    if (hal_dma_check_burst(burst, fifo, data_size, 0) < 0 || priority > AN_IRQ_PRIORITY_LOWEST) {
+        return -1;
+    }
+
+    // Allocate a DMA stream, if the handle doesn't have one already.
+    if (hal_dma_alloc(dma) < 0) {
+        return -1;
+    }
+    IRQn_Type irqn = hal_dma_irqn(dma);
+
     // Enable DMA clock
     __HAL_RCC_DMA1_CLK_ENABLE();
     __HAL_RCC_DMA2_CLK_ENABLE();
@@ -78,13 +550,21 @@ int hal_dma_config(DMA_HandleTypeDef *dma, IRQn_Type irqn, uint32_t direction) {
     dma->Init.Priority              = DMA_PRIORITY_VERY_HIGH;
     dma->Init.Direction             = direction;
     dma->Init.FIFOMode              = DMA_FIFOMODE_ENABLE;
-    dma->Init.FIFOThreshold         = DMA_FIFO_THRESHOLD_FULL;
+    dma->Init.FIFOThreshold         = DMA_FIFO_LUT[fifo];
     dma->Init.MemInc                = DMA_MINC_ENABLE;
     dma->Init.PeriphInc             = DMA_PINC_DISABLE;
-    dma->Init.MemBurst              = DMA_MBURST_SINGLE;
+    dma->Init.MemBurst              = DMA_BURST_LUT[burst];
     dma->Init.PeriphBurst           = DMA_PBURST_SINGLE;
-    dma->Init.MemDataAlignment      = DMA_MDATAALIGN_HALFWORD;
-    dma->Init.PeriphDataAlignment   = DMA_PDATAALIGN_HALFWORD;
+    if (data_size == 4) {
+        dma->Init.MemDataAlignment      = DMA_MDATAALIGN_WORD;
+        dma->Init.PeriphDataAlignment   = DMA_PDATAALIGN_WORD;
+    } else if (data_size == 1) {
+        dma->Init.MemDataAlignment      = DMA_MDATAALIGN_BYTE;
+        dma->Init.PeriphDataAlignment   = DMA_PDATAALIGN_BYTE;
+    } else {
+        dma->Init.MemDataAlignment      = DMA_MDATAALIGN_HALFWORD;
+        dma->Init.PeriphDataAlignment   = DMA_PDATAALIGN_HALFWORD;
+    }
 
     if (HAL_DMA_DeInit(dma) != HAL_OK
      || HAL_DMA_Init(dma) != HAL_OK) {
@@ -92,7 +572,7 @@ int hal_dma_config(DMA_HandleTypeDef *dma, IRQn_Type irqn, uint32_t direction) {
     }
 
     // NVIC configuration for DMA Input data interrupt.
-    HAL_NVIC_SetPriority(irqn, 0, 0);
+    HAL_NVIC_SetPriority(irqn, priority, 0);
     HAL_NVIC_EnableIRQ(irqn);
 
     return 0;
@@ -137,6 +617,61 @@ void hal_dma_update_memory(DMA_HandleTypeDef *dma, void *addr) {
     }
 }
 
+void hal_dma_play_init(hal_dma_play_t *play, const void *data, size_t size, size_t chunk,
+                       void *pad0, void *pad1, size_t sample_size, uint32_t silence, bool loop) {
+    play->data = (const uint8_t *) data;
+    play->size = size;
+    play->offset = 0;
+    play->chunk = chunk;
+    play->pad[0] = (uint8_t *) pad0;
+    play->pad[1] = (uint8_t *) pad1;
+    play->sample_size = sample_size;
+    play->silence = silence;
+    play->loop = loop;
+    play->done = 0;
+
+    // Make sure the DMA reads the samples, if they were just written to cached memory.
+    SCB_CleanDCache_by_Addr((uint32_t *) ((uint32_t) data & ~(__SCB_DCACHE_LINE_SIZE - 1)),
+                            size + __SCB_DCACHE_LINE_SIZE);
+}
+
+void *hal_dma_play_next(hal_dma_play_t *play, size_t ct) {
+    // Returns the next DMA transfer's memory address, or null once the last transfer
+    // with samples has been sent. The pad buffer for index ct is not used by the DMA.
+    if (play->loop && play->offset == play->size) {
+        play->offset = 0;
+    }
+
+    if (play->offset + play->chunk <= play->size) {
+        const uint8_t *addr = &play->data[play->offset];
+        play->offset += play->chunk;
+        return (void *) addr;
+    }
+
+    if (play->offset == play->size && !play->loop && play->done++) {
+        return nullptr;
+    }
+
+    // Copy the tail of the samples, then wrap around, or pad with silence.
+    uint8_t *pad = play->pad[ct];
+    size_t n = play->size - play->offset;
+    memcpy(pad, &play->data[play->offset], n);
+    play->offset = play->size;
+    while (play->loop && n < play->chunk) {
+        size_t len = play->chunk - n;
+        len = (len < play->size) ? len : play->size;
+        memcpy(&pad[n], play->data, len);
+        play->offset = len;
+        n += len;
+    }
+
+    for (; n < play->chunk; n += play->sample_size) {
+        memcpy(&pad[n], &play->silence, play->sample_size);
+    }
+    SCB_CleanDCache_by_Addr((uint32_t *) pad, play->chunk);
+    return pad;
+}
+
 int hal_dac_config(DAC_HandleTypeDef *dac, uint32_t channel, uint32_t trigger) {
     // DAC init
     if (dac->Instance == NULL) {
@@ -233,23 +768,213 @@ int hal_adc_enable_dual_mode(bool enable) {
     return 0;
 }
 
-int hal_i2s_config(I2S_HandleTypeDef *i2s, uint32_t sample_rate, uint32_t mode, bool mck_enable) {
-    // Set I2S clock source.
+// PLL3 limits, using a 1-2MHz reference clock and the medium VCO range.
+#define HAL_PLL3_REF_MAX    (2000000U)
+#define HAL_PLL3_VCO_MIN    (150000000.0)
+#define HAL_PLL3_VCO_MAX    (420000000.0)
+#define HAL_PLL3_OUT_MAX    (200000000.0)
+#define HAL_PLL3_FRACN_MAX  (8192U)
+// FRACN headroom (in ppm) that clock plans should leave for runtime trimming.
+#define HAL_PLL3_TRIM_PPM   (500.0)
+
+typedef struct {
+    uint32_t m;
+    uint32_t n;
+    uint32_t p;
+    uint32_t fracn;
+} hal_pll3_t;
+
+static uint32_t hal_pll_src_freq() {
+    switch (__HAL_RCC_GET_PLL_OSCSOURCE()) {
+        case RCC_PLLSOURCE_HSE:
+            return HSE_VALUE;
+        case RCC_PLLSOURCE_CSI:
+            return CSI_VALUE;
+        case RCC_PLLSOURCE_HSI:
+            return HSI_VALUE >> (__HAL_RCC_GET_HSI_DIVIDER() >> RCC_CR_HSIDIV_Pos);
+        default:
+            return 0;
+    }
+}
+
+static void hal_pll3_get(hal_pll3_t *pll) {
+    pll->m = (RCC->PLLCKSELR & RCC_PLLCKSELR_DIVM3) >> RCC_PLLCKSELR_DIVM3_Pos;
+    pll->n = (RCC->PLL3DIVR & RCC_PLL3DIVR_N3) + 1;
+    pll->p = ((RCC->PLL3DIVR & RCC_PLL3DIVR_P3) >> RCC_PLL3DIVR_P3_Pos) + 1;
+    pll->fracn = 0;
+    if (RCC->PLLCFGR & RCC_PLLCFGR_PLL3FRACEN) {
+        pll->fracn = (RCC->PLL3FRACR & RCC_PLL3FRACR_FRACN3) >> RCC_PLL3FRACR_FRACN3_Pos;
+    }
+}
+
+static double hal_pll3_get_freq() {
+    hal_pll3_t pll;
+    hal_pll3_get(&pll);
+    if (pll.m == 0 || !(RCC->CR & RCC_CR_PLL3ON)) {
+        return 0.0;
+    }
+    double ref = (double) hal_pll_src_freq() / pll.m;
+    return ref * (pll.n + (double) pll.fracn / HAL_PLL3_FRACN_MAX) / pll.p;
+}
+
+static int hal_pll3_plan(double clk, uint32_t div_min, uint32_t div_max, hal_pll3_t *pll, uint32_t *div_out) {
+    // Finds the PLL3 configuration, and the peripheral clock divider, that produce a clock
+    // closest to clk x div. The fractional divider makes almost any rate reachable, so
+    // plans that also leave enough FRACN headroom for trimming (in both directions) are
+    // preferred over ones that are only marginally more accurate.
+    uint32_t src = hal_pll_src_freq();
+    uint32_t m = (src + HAL_PLL3_REF_MAX - 1) / HAL_PLL3_REF_MAX;
+    if (src == 0 || m > 63 || (src / m) < (HAL_PLL3_REF_MAX / 2)) {
+        return -1;
+    }
+
+    bool found = false;
+    bool best_trim = false;
+    double best_err = 0.0;
+    double ref = (double) src / m;
+
+    for (uint32_t div=div_min; div<=div_max; div++) {
+        double out = clk * div;
+        if (out > HAL_PLL3_OUT_MAX) {
+            break;
+        }
+        uint32_t p_min = (uint32_t) ceil(HAL_PLL3_VCO_MIN / out);
+        uint32_t p_max = (uint32_t) floor(HAL_PLL3_VCO_MAX / out);
+        for (uint32_t p=p_min; p<=p_max && p<=128; p++) {
+            double n_real = out * p / ref;
+            uint32_t n = (uint32_t) n_real;
+            uint32_t fracn = (uint32_t) lround((n_real - n) * HAL_PLL3_FRACN_MAX);
+            if (fracn == HAL_PLL3_FRACN_MAX) {
+                n++;
+                fracn = 0;
+            }
+            if (n < 4 || n > 512) {
+                continue;
+            }
+            double err = fabs((n + (double) fracn / HAL_PLL3_FRACN_MAX) / n_real - 1.0);
+            uint32_t margin = (fracn < HAL_PLL3_FRACN_MAX / 2) ? fracn : (HAL_PLL3_FRACN_MAX - 1 - fracn);
+            bool trim = (margin * 1e6 / HAL_PLL3_FRACN_MAX / n_real) >= HAL_PLL3_TRIM_PPM;
+            if (!found || (trim && !best_trim) || (trim == best_trim && err < best_err)) {
+                found = true;
+                best_err = err;
+                best_trim = trim;
+                *div_out = div;
+                pll->m = m;
+                pll->n = n;
+                pll->p = p;
+                pll->fracn = fracn;
+            }
+        }
+    }
+    return found ? 0 : -1;
+}
+
+static void hal_pll3_select(uint32_t periph) {
+    if (periph == RCC_PERIPHCLK_SPI123) {
+        __HAL_RCC_SPI123_CONFIG(RCC_SPI123CLKSOURCE_PLL3);
+    } else if (periph == RCC_PERIPHCLK_SAI1) {
+        __HAL_RCC_SAI1_CONFIG(RCC_SAI1CLKSOURCE_PLL3);
+    } else if (periph == RCC_PERIPHCLK_SAI23) {
+        __HAL_RCC_SAI23_CONFIG(RCC_SAI23CLKSOURCE_PLL3);
+    }
+}
+
+static int hal_pll3_config(hal_pll3_t *pll, uint32_t periph) {
+    // PLL3 is shared by SPI1/2/3 and SAI, so skip reconfiguring it if it's already running
+    // with the same configuration, as that would glitch any active streams. In that case,
+    // only the peripheral's kernel clock mux is switched to PLL3.
+    hal_pll3_t cur;
+    hal_pll3_get(&cur);
+    if ((RCC->CR & RCC_CR_PLL3RDY) && !memcmp(&cur, pll, sizeof(hal_pll3_t))) {
+        hal_pll3_select(periph);
+        return 0;
+    }
+
     RCC_PeriphCLKInitTypeDef pclk_init = {0};
-    pclk_init.PLL3.PLL3M = 16;
-    pclk_init.PLL3.PLL3N = 344;
-    pclk_init.PLL3.PLL3P = 7;
+    pclk_init.PLL3.PLL3M = pll->m;
+    pclk_init.PLL3.PLL3N = pll->n;
+    pclk_init.PLL3.PLL3P = pll->p;
     pclk_init.PLL3.PLL3Q = 5;
     pclk_init.PLL3.PLL3R = 5;
-    pclk_init.PLL3.PLL3FRACN = 0;
+    pclk_init.PLL3.PLL3FRACN = pll->fracn;
     pclk_init.PLL3.PLL3RGE = RCC_PLL3VCIRANGE_0;
     pclk_init.PLL3.PLL3VCOSEL = RCC_PLL3VCOMEDIUM;
-    pclk_init.PeriphClockSelection |= RCC_PERIPHCLK_SPI123;
+    pclk_init.PeriphClockSelection  = periph;
     pclk_init.Spi123ClockSelection  = RCC_SPI123CLKSOURCE_PLL3;
+    pclk_init.Sai1ClockSelection    = RCC_SAI1CLKSOURCE_PLL3;
+    pclk_init.Sai23ClockSelection   = RCC_SAI23CLKSOURCE_PLL3;
 
     if (HAL_RCCEx_PeriphCLKConfig(&pclk_init) != HAL_OK) {
         return -1;
     }
+    return 0;
+}
+
+static uint32_t hal_i2s_frame_bits(bool mck_enable, bool chlen_16) {
+    // With MCLK enabled, the I2S clock is divided down from MCLK which is fixed at 256 x Fs.
+    if (mck_enable) {
+        return 256;
+    }
+    return chlen_16 ? 32 : 64;
+}
+
+static uint32_t hal_i2s_get_div(I2S_HandleTypeDef *i2s) {
+    uint32_t cfgr = i2s->Instance->I2SCFGR;
+    uint32_t div = (cfgr & SPI_I2SCFGR_I2SDIV) >> SPI_I2SCFGR_I2SDIV_Pos;
+    div = (div == 0) ? 1 : ((div * 2) + ((cfgr & SPI_I2SCFGR_ODD) ? 1 : 0));
+    return div * hal_i2s_frame_bits(cfgr & SPI_I2SCFGR_MCKOE, !(cfgr & SPI_I2SCFGR_CHLEN));
+}
+
+float hal_i2s_get_freq(I2S_HandleTypeDef *i2s) {
+    return hal_pll3_get_freq() / hal_i2s_get_div(i2s);
+}
+
+int hal_i2s_set_freq(I2S_HandleTypeDef *i2s, float sample_rate) {
+    // Only FRACN can be changed on the fly without stopping PLL3, so the new rate must be
+    // within the fractional range of the current integer multiplier.
+    hal_pll3_t pll;
+    hal_pll3_get(&pll);
+    if (pll.m == 0 || !(RCC->PLLCFGR & RCC_PLLCFGR_PLL3FRACEN)) {
+        return -1;
+    }
+
+    double ref = (double) hal_pll_src_freq() / pll.m;
+    double n_real = (double) sample_rate * hal_i2s_get_div(i2s) * pll.p / ref;
+    int32_t fracn = (int32_t) lround((n_real - pll.n) * HAL_PLL3_FRACN_MAX);
+    if (fracn < 0 || fracn >= (int32_t) HAL_PLL3_FRACN_MAX) {
+        return -1;
+    }
+
+    // The new fractional value is latched when FRACEN is set again.
+    __HAL_RCC_PLL3FRACN_DISABLE();
+    __HAL_RCC_PLL3FRACN_CONFIG(fracn);
+    __HAL_RCC_PLL3FRACN_ENABLE();
+    return 0;
+}
+
+int hal_i2s_config(I2S_HandleTypeDef *i2s, uint32_t sample_rate, uint32_t mode, bool mck_enable, uint32_t data_format) {
+    bool slave = (mode == I2S_MODE_SLAVE_TX || mode == I2S_MODE_SLAVE_RX || mode == I2S_MODE_SLAVE_FULLDUPLEX);
+
+    if (slave) {
+        // The bit clock comes from the external master, so PLL3 is left as is, as it
+        // may be clocking other streams. The kernel clock is only switched to PLL3 if
+        // it's already running, otherwise the default kernel clock is kept.
+        if (RCC->CR & RCC_CR_PLL3RDY) {
+            hal_pll3_select(RCC_PERIPHCLK_SPI123);
+        }
+    } else {
+        // Set I2S clock source. PLL3 is configured to produce an exact multiple of the
+        // bit clock (or MCLK), so the I2S prescaler divides it without any rounding error.
+        hal_pll3_t pll;
+        uint32_t div = 0;
+        double clk = (double) sample_rate * hal_i2s_frame_bits(mck_enable, data_format == I2S_DATAFORMAT_16B);
+
+        // NOTE: The smallest divider is 4, since dividers below that are either bypassed
+        // or not allowed, and all supported rates can be reached with larger ones.
+        if (hal_pll3_plan(clk, 4, 511, &pll, &div) != 0 || hal_pll3_config(&pll, RCC_PERIPHCLK_SPI123) != 0) {
+            return -1;
+        }
+    }
 
     // Enable I2S clock
     if (i2s->Instance == SPI1) {
@@ -262,13 +987,14 @@ int hal_i2s_config(I2S_HandleTypeDef *i2s, uint32_t sample_rate, uint32_t mode,
 
     i2s->Init.Mode = mode;
     i2s->Init.Standard = I2S_STANDARD_PHILIPS;
-    i2s->Init.DataFormat = I2S_DATAFORMAT_16B_EXTENDED;
+    i2s->Init.DataFormat = data_format;
     i2s->Init.MCLKOutput = mck_enable ? I2S_MCLKOUTPUT_ENABLE : I2S_MCLKOUTPUT_DISABLE;
     i2s->Init.AudioFreq = sample_rate;
     i2s->Init.CPOL = I2S_CPOL_LOW;
     i2s->Init.FirstBit = I2S_FIRSTBIT_MSB;
     i2s->Init.WSInversion = I2S_WS_INVERSION_DISABLE;
-    i2s->Init.Data24BitAlignment = I2S_DATA_24BIT_ALIGNMENT_RIGHT;
+    // 24-bit samples are left-aligned, so they can be used as full-scale 32-bit samples.
+    i2s->Init.Data24BitAlignment = I2S_DATA_24BIT_ALIGNMENT_LEFT;
     i2s->Init.MasterKeepIOState = I2S_MASTER_KEEP_IO_STATE_DISABLE;
 
     HAL_I2S_DeInit(i2s);
@@ -277,3 +1003,56 @@ int hal_i2s_config(I2S_HandleTypeDef *i2s, uint32_t sample_rate, uint32_t mode,
     }
     return 0;
 }
+
+int hal_sai_config(SAI_HandleTypeDef *sai, uint32_t sample_rate, uint32_t mode,
+                   bool mck_enable, uint32_t data_size, uint32_t n_slots) {
+    uint32_t periph = (sai->Instance == SAI1_Block_A) ? RCC_PERIPHCLK_SAI1 : RCC_PERIPHCLK_SAI23;
+    uint32_t frame_bits = n_slots * ((data_size == SAI_PROTOCOL_DATASIZE_16BIT) ? 16 : 32);
+
+    // Set SAI clock source. Without MCLK, the bit clock is divided directly from the kernel
+    // clock, otherwise it's divided from MCLK which is fixed at 256 x Fs. Either way, PLL3
+    // is configured to produce an exact multiple of it (see hal_i2s_config).
+    if (mode == SAI_MODESLAVE_RX || mode == SAI_MODESLAVE_TX) {
+        // The bit clock comes from the external master, so PLL3 is left as is (see
+        // hal_i2s_config).
+        if (RCC->CR & RCC_CR_PLL3RDY) {
+            hal_pll3_select(periph);
+        }
+    } else {
+        hal_pll3_t pll;
+        uint32_t div = 0;
+        double clk = (double) sample_rate * (mck_enable ? 256 : frame_bits);
+        if (hal_pll3_plan(clk, 1, 63, &pll, &div) != 0 || hal_pll3_config(&pll, periph) != 0) {
+            return -1;
+        }
+    }
+
+    // Enable SAI clock
+    if (sai->Instance == SAI1_Block_A) {
+        __HAL_RCC_SAI1_CLK_ENABLE();
+    } else if (sai->Instance == SAI2_Block_A) {
+        __HAL_RCC_SAI2_CLK_ENABLE();
+    }
+
+    sai->Init.AudioMode = mode;
+    sai->Init.Synchro = SAI_ASYNCHRONOUS;
+    sai->Init.SynchroExt = SAI_SYNCEXT_DISABLE;
+    sai->Init.OutputDrive = SAI_OUTPUTDRIVE_ENABLE;
+    sai->Init.NoDivider = mck_enable ? SAI_MASTERDIVIDER_ENABLE : SAI_MASTERDIVIDER_DISABLE;
+    sai->Init.MckOutput = mck_enable ? SAI_MCK_OUTPUT_ENABLE : SAI_MCK_OUTPUT_DISABLE;
+    sai->Init.MckOverSampling = SAI_MCK_OVERSAMPLING_DISABLE;
+    sai->Init.FIFOThreshold = SAI_FIFOTHRESHOLD_1QF;
+    sai->Init.AudioFrequency = sample_rate;
+    sai->Init.MonoStereoMode = SAI_STEREOMODE;
+    sai->Init.CompandingMode = SAI_NOCOMPANDING;
+    sai->Init.TriState = SAI_OUTPUT_NOTRELEASED;
+    sai->Init.PdmInit.Activation = DISABLE;
+
+    // TDM frames use a one bit clock frame sync pulse before the first slot, with all
+    // slots active, which is what HAL's short PCM protocol configures.
+    HAL_SAI_DeInit(sai);
+    if (HAL_SAI_InitProtocol(sai, SAI_PCM_SHORT, data_size, n_slots) != HAL_OK) {
+        return -1;
+    }
+    return 0;
+}
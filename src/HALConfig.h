@@ -23,15 +23,107 @@
 #include "Arduino.h"
 #include "AdvancedAnalog.h"
 
+// Zero-copy playback of samples in memory, in fixed-size DMA transfers. Transfers point
+// straight into the samples, except at the end of the data, where the tail is copied
+// into a pad buffer and completed with the start of the data (loop) or with silence.
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    size_t offset;
+    size_t chunk;
+    uint8_t *pad[2];
+    size_t sample_size;
+    uint32_t silence;
+    bool loop;
+    uint32_t done;
+} hal_dma_play_t;
+
+// Non-cacheable DMA memory allocator. Allocations are freed by address, or by owner once
+// the owner (i.e. the DMAPool) is created.
+int hal_dma_mem_check();
+void *hal_dma_mem_alloc(size_t size);
+void hal_dma_mem_bind(void *mem, const void *owner);
+void hal_dma_mem_free(const void *ptr);
+
+// Caller-provided memory that pools are carved from, in order.
+typedef struct {
+    uint8_t *mem;
+    size_t size;
+} hal_dma_arena_t;
+
+template <typename T>
+DMAPool<T> *hal_dma_pool_new(size_t n_samples, size_t n_channels, size_t n_buffers, uint32_t memory,
+                             hal_dma_arena_t *arena=nullptr) {
+    size_t size = AN_DMA_ARENA_SIZE(T, n_samples, n_channels, n_buffers);
+    if (size == 0) {
+        return new DMAPool<T>(n_samples, n_channels, n_buffers);
+    }
+
+    if (arena != nullptr && arena->mem != nullptr) {
+        // Buffers are aligned to the cache line size, so that cache maintenance on
+        // one buffer doesn't affect its neighbours.
+        uint8_t *mem = (uint8_t *) (((uintptr_t) arena->mem + __SCB_DCACHE_LINE_SIZE - 1) &
+                                    ~(__SCB_DCACHE_LINE_SIZE - 1));
+        size_t used = (mem - arena->mem) + size;
+        if (used > arena->size) {
+            return nullptr;
+        }
+        DMAPool<T> *pool = new DMAPool<T>(n_samples, n_channels, n_buffers, __SCB_DCACHE_LINE_SIZE, mem);
+        if (pool != nullptr) {
+            arena->mem += used;
+            arena->size -= used;
+        }
+        return pool;
+    }
+
+    if (memory == AN_DMA_MEM_CACHED) {
+        return new DMAPool<T>(n_samples, n_channels, n_buffers);
+    }
+
+    void *mem = hal_dma_mem_alloc(size);
+    if (mem == nullptr) {
+        return nullptr;
+    }
+
+    DMAPool<T> *pool = new DMAPool<T>(n_samples, n_channels, n_buffers, __SCB_DCACHE_LINE_SIZE, mem);
+    if (pool == nullptr) {
+        hal_dma_mem_free(mem);
+        return nullptr;
+    }
+    hal_dma_mem_bind(mem, pool);
+    return pool;
+}
+
+template <typename T>
+void hal_dma_pool_delete(DMAPool<T> *pool) {
+    hal_dma_mem_free(pool);
+    delete pool;
+}
+
 int hal_tim_config(TIM_HandleTypeDef *tim, uint32_t t_freq);
-int hal_dma_config(DMA_HandleTypeDef *dma, IRQn_Type irqn, uint32_t direction);
+int hal_tim_set_freq(TIM_HandleTypeDef *tim, uint32_t t_freq);
+int hal_tim_sync(TIM_HandleTypeDef **tim, size_t n_tim);
+void hal_dma_free(DMA_HandleTypeDef *dma);
+IRQn_Type hal_dma_irqn(DMA_HandleTypeDef *dma);
+void hal_dma_set_priority(DMA_HandleTypeDef *dma, uint32_t priority);
+int hal_dma_config(DMA_HandleTypeDef *dma, uint32_t direction, size_t data_size=sizeof(Sample),
+                   uint32_t burst=AN_DMA_BURST_SINGLE, uint32_t fifo=AN_DMA_FIFO_FULL,
+                   uint32_t priority=AN_IRQ_PRIORITY_HIGHEST);
+int hal_dma_check_burst(uint32_t burst, uint32_t fifo, size_t data_size, size_t n_bytes);
 size_t hal_dma_get_ct(DMA_HandleTypeDef *dma);
 void hal_dma_enable_dbm(DMA_HandleTypeDef *dma, void *m0 = nullptr, void *m1 = nullptr);
 void hal_dma_update_memory(DMA_HandleTypeDef *dma, void *addr);
+void hal_dma_play_init(hal_dma_play_t *play, const void *data, size_t size, size_t chunk,
+                       void *pad0, void *pad1, size_t sample_size, uint32_t silence, bool loop);
+void *hal_dma_play_next(hal_dma_play_t *play, size_t ct);
 int hal_dac_config(DAC_HandleTypeDef *dac, uint32_t channel, uint32_t trigger);
 int hal_adc_config(ADC_HandleTypeDef *adc, uint32_t resolution, uint32_t trigger,
                    PinName *adc_pins, uint32_t n_channels, uint32_t sample_time);
 int hal_adc_enable_dual_mode(bool enable);
-int hal_i2s_config(I2S_HandleTypeDef *i2s, uint32_t sample_rate, uint32_t mode, bool mck_enable);
+int hal_i2s_config(I2S_HandleTypeDef *i2s, uint32_t sample_rate, uint32_t mode, bool mck_enable, uint32_t data_format);
+float hal_i2s_get_freq(I2S_HandleTypeDef *i2s);
+int hal_i2s_set_freq(I2S_HandleTypeDef *i2s, float sample_rate);
+int hal_sai_config(SAI_HandleTypeDef *sai, uint32_t sample_rate, uint32_t mode,
+                   bool mck_enable, uint32_t data_size, uint32_t n_slots);
 
 #endif  // __HAL_CONFIG_H__
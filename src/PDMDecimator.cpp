@@ -0,0 +1,204 @@
+/*
+  This file is part of the Arduino_AdvancedAnalog library.
+  Copyright (c) 2024 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Arduino.h"
+#include "PDMDecimator.h"
+
+#define PDM_CIC_TAPS        (AN_PDM_CIC_ORDER * (AN_PDM_CIC_DECIM - 1) + 1)
+#define PDM_CIC_BYTES       (8)
+// FIR decimation factor, from the CIC output rate to the PCM rate.
+#define PDM_FIR_DECIM       (AN_PDM_DECIMATION / AN_PDM_CIC_DECIM)
+// FIR cut-off, relative to the PCM sample rate, and Kaiser window shape.
+#define PDM_FIR_CUTOFF      (0.45)
+#define PDM_FIR_BETA        (6.0)
+#define PDM_FIR_STEPS       (128)
+// DC blocker pole, as a right shift: (1 - 2^-10) gives a ~7Hz corner at 48KHz.
+#define PDM_DC_SHIFT        (10)
+
+static double pdm_bessel_i0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k=1; term > 1e-12 * sum; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// Magnitude response of the CIC stage, at a frequency relative to its output rate.
+static double pdm_cic_response(double f) {
+    if (f == 0.0) {
+        return 1.0;
+    }
+    double r = sin(M_PI * f) / (AN_PDM_CIC_DECIM * sin(M_PI * f / AN_PDM_CIC_DECIM));
+    return pow(fabs(r), AN_PDM_CIC_ORDER);
+}
+
+static inline int32_t pdm_cic_filter(const int16_t *lut, uint64_t bits) {
+    uint32_t lo = (uint32_t) bits;
+    uint32_t hi = (uint32_t) (bits >> 32);
+    int32_t acc = lut[0x000 | ((lo >>  0) & 0xFF)] + lut[0x100 | ((lo >>  8) & 0xFF)]
+                + lut[0x200 | ((lo >> 16) & 0xFF)] + lut[0x300 | ((lo >> 24) & 0xFF)]
+                + lut[0x400 | ((hi >>  0) & 0xFF)] + lut[0x500 | ((hi >>  8) & 0xFF)]
+                + lut[0x600 | ((hi >> 16) & 0xFF)] + lut[0x700 | ((hi >> 24) & 0xFF)];
+    // The CIC gain is 2^16, scale it down to 16 bits.
+    return __SSAT(acc >> 1, 16);
+}
+
+PDMDecimator::~PDMDecimator() {
+    if (cic_lut) {
+        delete [] cic_lut;
+    }
+}
+
+int PDMDecimator::begin(float gain) {
+    if (gain <= 0.0f) {
+        return 0;
+    }
+
+    if (cic_lut == nullptr) {
+        cic_lut = new int16_t[PDM_CIC_BYTES * 256];
+        if (cic_lut == nullptr) {
+            return 0;
+        }
+    }
+
+    // The CIC is applied as a FIR: its kernel is a boxcar convolved with itself
+    // ORDER times. The kernel fits in 8 bytes of the bitstream, so the response to
+    // every byte value is precomputed for each byte position in the window.
+    int32_t kernel[PDM_CIC_BYTES * 8] = { 0 };
+    kernel[0] = 1;
+    for (size_t o=0; o<AN_PDM_CIC_ORDER; o++) {
+        for (int i=PDM_CIC_TAPS-1; i>=0; i--) {
+            int32_t sum = 0;
+            for (int j=0; j<AN_PDM_CIC_DECIM && j<=i; j++) {
+                sum += kernel[i - j];
+            }
+            kernel[i] = sum;
+        }
+    }
+
+    for (size_t b=0; b<PDM_CIC_BYTES; b++) {
+        for (size_t v=0; v<256; v++) {
+            int32_t sum = 0;
+            for (size_t i=0; i<8; i++) {
+                // Bit 0 (the most recent bit) lines up with the first tap of this byte.
+                sum += (v & (1 << i)) ? kernel[b * 8 + i] : -kernel[b * 8 + i];
+            }
+            if (sum > INT16_MAX || sum < INT16_MIN) {
+                return 0;
+            }
+            cic_lut[(b << 8) | v] = sum;
+        }
+    }
+
+    // The compensation FIR is designed by frequency sampling: a low-pass filter whose
+    // pass-band is the inverse of the CIC droop, shaped with a Kaiser window.
+    double taps[AN_PDM_FIR_TAPS];
+    double fc = PDM_FIR_CUTOFF / PDM_FIR_DECIM;
+    double center = (AN_PDM_FIR_TAPS - 1) / 2.0;
+    double i0_beta = pdm_bessel_i0(PDM_FIR_BETA);
+    double dc = 0.0;
+    for (size_t n=0; n<AN_PDM_FIR_TAPS; n++) {
+        double sum = 0.0;
+        for (size_t k=0; k<PDM_FIR_STEPS; k++) {
+            double f = fc * (k + 0.5) / PDM_FIR_STEPS;
+            sum += cos(2.0 * M_PI * f * (n - center)) / pdm_cic_response(f);
+        }
+        double r = (n - center) / center;
+        taps[n] = (2.0 * fc * sum / PDM_FIR_STEPS) * pdm_bessel_i0(PDM_FIR_BETA * sqrt(1.0 - r * r)) / i0_beta;
+        dc += taps[n];
+    }
+
+    // Normalize to unity gain at DC, apply the gain, and quantize the coefficients
+    // with as many fractional bits as the largest one allows.
+    double peak = 0.0;
+    for (size_t n=0; n<AN_PDM_FIR_TAPS; n++) {
+        taps[n] = taps[n] * gain / dc;
+        peak = (fabs(taps[n]) > peak) ? fabs(taps[n]) : peak;
+    }
+
+    fir_shift = 0;
+    while (fir_shift < 30 && peak * (1UL << (fir_shift + 1)) < INT16_MAX) {
+        fir_shift++;
+    }
+
+    if (peak * (1UL << fir_shift) > INT16_MAX) {
+        return 0;
+    }
+
+    for (size_t n=0; n<AN_PDM_FIR_TAPS; n++) {
+        fir[n] = (int16_t) lround(taps[n] * (1UL << fir_shift));
+    }
+
+    reset();
+    return 1;
+}
+
+void PDMDecimator::reset() {
+    // An idle PDM stream alternates between 0 and 1.
+    hist = 0xAAAAAAAAAAAAAAAAULL;
+    memset(delay, 0, sizeof(delay));
+    delay_idx = 0;
+    phase = 0;
+    dc_x1 = 0;
+    dc_y1 = 0;
+}
+
+size_t PDMDecimator::decimate(const uint32_t *pdm, size_t n_words, int16_t *pcm) {
+    size_t n_out = 0;
+    const int16_t *lut = cic_lut;
+
+    if (lut == nullptr) {
+        return 0;
+    }
+
+    for (size_t i=0; i<n_words; i++) {
+        // Words are received MSB first, so each one yields two CIC outputs, one
+        // after its upper half, and another one after its lower half.
+        uint32_t w = pdm[i];
+        int32_t cic[2];
+        cic[0] = pdm_cic_filter(lut, (hist << 16) | (w >> 16));
+        hist = (hist << 32) | w;
+        cic[1] = pdm_cic_filter(lut, hist);
+
+        for (size_t j=0; j<2; j++) {
+            delay_idx = (delay_idx == 0) ? (AN_PDM_FIR_TAPS - 1) : (delay_idx - 1);
+            delay[delay_idx] = delay[delay_idx + AN_PDM_FIR_TAPS] = cic[j];
+
+            if (++phase < PDM_FIR_DECIM) {
+                continue;
+            }
+            phase = 0;
+
+            int64_t acc = 0;
+            const int16_t *x = &delay[delay_idx];
+            for (size_t k=0; k<AN_PDM_FIR_TAPS; k++) {
+                acc += (int32_t) fir[k] * x[k];
+            }
+
+            // Remove the DC offset of the microphone. The blocker state keeps extra
+            // fractional bits, otherwise the truncated leak leaves a residual offset.
+            int32_t s = (int32_t) (acc >> fir_shift);
+            dc_y1 += ((s - dc_x1) << PDM_DC_SHIFT) - (dc_y1 >> PDM_DC_SHIFT);
+            dc_x1 = s;
+            pcm[n_out++] = __SSAT(dc_y1 >> PDM_DC_SHIFT, 16);
+        }
+    }
+    return n_out;
+}
@@ -0,0 +1,56 @@
+/*
+  This file is part of the Arduino_AdvancedAnalog library.
+  Copyright (c) 2024 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_PDM_DECIMATOR_H__
+#define __ADVANCED_PDM_DECIMATOR_H__
+
+#include "AdvancedAnalog.h"
+
+// Total decimation factor, i.e. PDM bits per PCM sample.
+#define AN_PDM_DECIMATION   (64)
+// CIC stage order and decimation factor.
+#define AN_PDM_CIC_ORDER    (4)
+#define AN_PDM_CIC_DECIM    (16)
+// Compensation FIR taps (the FIR decimates the CIC output by 4).
+#define AN_PDM_FIR_TAPS     (64)
+
+class PDMDecimator {
+    private:
+        // CIC kernel contribution of each byte value, for each of the 8 bytes in the window.
+        int16_t *cic_lut;
+        int16_t fir[AN_PDM_FIR_TAPS];
+        // FIR delay line, stored twice so the taps can always be read contiguously.
+        int16_t delay[AN_PDM_FIR_TAPS * 2];
+        uint64_t hist;
+        size_t delay_idx;
+        uint32_t phase;
+        uint32_t fir_shift;
+        int32_t dc_x1;
+        int32_t dc_y1;
+
+    public:
+        PDMDecimator(): cic_lut(nullptr), hist(0), delay_idx(0), phase(0), fir_shift(0), dc_x1(0), dc_y1(0) {
+        }
+        ~PDMDecimator();
+        int begin(float gain=1.0f);
+        void reset();
+        size_t decimate(const uint32_t *pdm, size_t n_words, int16_t *pcm);
+};
+
+#endif // __ADVANCED_PDM_DECIMATOR_H__
@@ -0,0 +1,235 @@
+/*
+  This file is part of the Arduino_AdvancedAnalog library.
+  Copyright (c) 2024 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Arduino.h"
+#include "SampleMixer.h"
+
+enum {
+    MIXER_SOURCE_WAV,
+    MIXER_SOURCE_ADC,
+    MIXER_SOURCE_I2S,
+    MIXER_SOURCE_DDS,
+};
+
+struct mixer_source_t {
+    uint32_t type;
+    void *source;
+    int32_t gain;
+    uint32_t shift;
+    uint32_t flip;
+    Sample *scratch;
+    DMABuffer<Sample> *buf;
+};
+
+static uint32_t MIXER_RES_LUT[] = {
+    8, 10, 12, 14, 16
+};
+
+static int32_t mixer_gain_q15(float gain) {
+    return (int32_t) (constrain(gain, -16.0f, 16.0f) * 32768.0f);
+}
+
+static bool mixer_source_available(mixer_source_t *src) {
+    switch (src->type) {
+        case MIXER_SOURCE_WAV:
+            return ((WavReader *) src->source)->available();
+        case MIXER_SOURCE_ADC:
+            return ((AdvancedADC *) src->source)->available();
+        case MIXER_SOURCE_I2S:
+            return ((AdvancedI2S *) src->source)->available();
+        default:
+            return true;
+    }
+}
+
+static void mixer_source_release(mixer_source_t *src) {
+    if (src->buf) {
+        src->buf->release();
+        src->buf = nullptr;
+    }
+}
+
+SampleMixer::~SampleMixer() {
+    stop();
+}
+
+int SampleMixer::begin(uint32_t resolution, size_t n_samples, size_t n_channels, bool is_signed) {
+    // Sanity checks.
+    if (resolution >= AN_ARRAY_SIZE(MIXER_RES_LUT) || n_samples == 0 || n_channels == 0 || sources) {
+        return 0;
+    }
+
+    // Signed output is only supported for 16-bit PCM (e.g. I2S).
+    if (is_signed && resolution != AN_RESOLUTION_16) {
+        return 0;
+    }
+
+    sources = new mixer_source_t[AN_MAX_MIXER_SOURCES];
+    if (sources == nullptr) {
+        return 0;
+    }
+
+    this->n_sources = 0;
+    this->n_samples = n_samples;
+    this->n_channels = n_channels;
+    this->shift = 16 - MIXER_RES_LUT[resolution];
+    this->is_signed = is_signed;
+    return 1;
+}
+
+void SampleMixer::stop() {
+    if (sources) {
+        for (size_t i=0; i<n_sources; i++) {
+            mixer_source_release(&sources[i]);
+            if (sources[i].scratch) {
+                delete [] sources[i].scratch;
+            }
+        }
+        delete [] sources;
+    }
+    sources = nullptr;
+    n_sources = 0;
+}
+
+int SampleMixer::add(uint32_t type, void *source, float gain, uint32_t resolution, bool is_signed) {
+    if (sources == nullptr || n_sources == AN_MAX_MIXER_SOURCES || resolution >= AN_ARRAY_SIZE(MIXER_RES_LUT)) {
+        return -1;
+    }
+
+    mixer_source_t *src = &sources[n_sources];
+    src->type = type;
+    src->source = source;
+    src->gain = mixer_gain_q15(gain);
+    src->buf = nullptr;
+    src->scratch = nullptr;
+    // All sources are converted to signed 16-bit: unsigned samples are left-aligned
+    // and their sign bit is flipped, which moves mid-scale to zero.
+    src->shift = 16 - MIXER_RES_LUT[resolution];
+    src->flip = is_signed ? 0 : 0x8000;
+
+    if (type == MIXER_SOURCE_DDS) {
+        // Generators don't have a queue, so they render into their own buffer.
+        src->scratch = new Sample[n_samples * n_channels];
+        if (src->scratch == nullptr) {
+            return -1;
+        }
+    }
+    return n_sources++;
+}
+
+int SampleMixer::add(WavReader &wav, float gain) {
+    return add(MIXER_SOURCE_WAV, &wav, gain, AN_RESOLUTION_16, true);
+}
+
+int SampleMixer::add(AdvancedADC &adc, float gain, uint32_t resolution) {
+    return add(MIXER_SOURCE_ADC, &adc, gain, resolution, false);
+}
+
+int SampleMixer::add(AdvancedI2S &i2s, float gain) {
+    return add(MIXER_SOURCE_I2S, &i2s, gain, AN_RESOLUTION_16, true);
+}
+
+int SampleMixer::add(DDSGenerator &dds, float gain) {
+    uint32_t resolution = (dds.resolution() - 8) / 2;
+    return add(MIXER_SOURCE_DDS, &dds, gain, resolution, false);
+}
+
+void SampleMixer::gain(int source, float gain) {
+    if (sources && source >= 0 && (size_t) source < n_sources) {
+        sources[source].gain = mixer_gain_q15(gain);
+    }
+}
+
+bool SampleMixer::available() {
+    if (sources == nullptr || n_sources == 0) {
+        return false;
+    }
+    for (size_t i=0; i<n_sources; i++) {
+        if (!mixer_source_available(&sources[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int SampleMixer::mix(SampleBuffer outbuf) {
+    Sample *data[AN_MAX_MIXER_SOURCES];
+    int32_t gain[AN_MAX_MIXER_SOURCES];
+    uint32_t src_shift[AN_MAX_MIXER_SOURCES];
+    uint32_t flip[AN_MAX_MIXER_SOURCES];
+    size_t n_src = n_sources;
+    size_t size = n_samples * n_channels;
+    int ret = 1;
+
+    if (!outbuf || outbuf.size() != size || !available()) {
+        return 0;
+    }
+
+    // Collect one buffer from every source, so they can all be mixed in a single pass.
+    for (size_t i=0; i<n_src; i++) {
+        mixer_source_t *src = &sources[i];
+        switch (src->type) {
+            case MIXER_SOURCE_WAV:
+                src->buf = &((WavReader *) src->source)->read();
+                break;
+            case MIXER_SOURCE_ADC:
+                src->buf = &((AdvancedADC *) src->source)->read();
+                break;
+            case MIXER_SOURCE_I2S:
+                src->buf = &((AdvancedI2S *) src->source)->read();
+                break;
+            case MIXER_SOURCE_DDS:
+                ((DDSGenerator *) src->source)->generate(src->scratch, n_samples, n_channels);
+                break;
+        }
+
+        if (src->buf && src->buf->size() != size) {
+            // All sources must have the same buffer geometry as the output. Buffers
+            // can't be returned to a source's queue once read, so they're dropped.
+            ret = 0;
+        }
+
+        data[i] = src->buf ? src->buf->data() : src->scratch;
+        gain[i] = src->gain;
+        src_shift[i] = src->shift;
+        flip[i] = src->flip;
+    }
+
+    if (ret) {
+        Sample *out = outbuf.data();
+        uint32_t out_shift = shift;
+        uint32_t out_flip = is_signed ? 0 : 0x8000;
+
+        for (size_t n=0; n<size; n++) {
+            int64_t acc = 0;
+            for (size_t i=0; i<n_src; i++) {
+                int32_t s = (int16_t) ((data[i][n] << src_shift[i]) ^ flip[i]);
+                acc += (int64_t) s * gain[i];
+            }
+            // Saturate to 16 bits, then convert to the output format.
+            int32_t v = __SSAT((int32_t) (acc >> 15), 16);
+            out[n] = (Sample) (((uint16_t) v ^ out_flip) >> out_shift);
+        }
+    }
+
+    for (size_t i=0; i<n_src; i++) {
+        mixer_source_release(&sources[i]);
+    }
+    return ret;
+}
@@ -0,0 +1,58 @@
+/*
+  This file is part of the Arduino_AdvancedAnalog library.
+  Copyright (c) 2024 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_SAMPLE_MIXER_H__
+#define __ADVANCED_SAMPLE_MIXER_H__
+
+#include "AdvancedAnalog.h"
+#include "AdvancedADC.h"
+#include "AdvancedI2S.h"
+#include "WavReader.h"
+#include "DDSGenerator.h"
+
+#define AN_MAX_MIXER_SOURCES    (8)
+
+struct mixer_source_t;
+
+class SampleMixer {
+    private:
+        size_t n_sources;
+        size_t n_samples;
+        size_t n_channels;
+        uint32_t shift;
+        bool is_signed;
+        mixer_source_t *sources;
+        int add(uint32_t type, void *source, float gain, uint32_t resolution, bool is_signed);
+
+    public:
+        SampleMixer(): n_sources(0), n_samples(0), n_channels(0), shift(0), is_signed(false), sources(nullptr) {
+        }
+        ~SampleMixer();
+        int begin(uint32_t resolution, size_t n_samples, size_t n_channels=1, bool is_signed=false);
+        void stop();
+        int add(WavReader &wav, float gain=1.0f);
+        int add(AdvancedADC &adc, float gain=1.0f, uint32_t resolution=AN_RESOLUTION_12);
+        int add(AdvancedI2S &i2s, float gain=1.0f);
+        int add(DDSGenerator &dds, float gain=1.0f);
+        void gain(int source, float gain);
+        bool available();
+        int mix(SampleBuffer buf);
+};
+
+#endif // __ADVANCED_SAMPLE_MIXER_H__
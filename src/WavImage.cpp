@@ -0,0 +1,77 @@
+/*
+  This file is part of the Arduino_AdvancedAnalog library.
+  Copyright (c) 2024 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Arduino.h"
+#include "WavImage.h"
+
+#define WAV_FORMAT_PCM          (0x0001)
+#define WAV_FORMAT_EXTENSIBLE   (0xFFFE)
+
+static uint32_t wav_get_u32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static uint16_t wav_get_u16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+int WavImage::begin(const void *image, size_t size) {
+    const uint8_t *p = (const uint8_t *) image;
+    uint16_t audio_format = 0;
+
+    samples = nullptr;
+    n_bytes = 0;
+
+    if (p == nullptr || size < 12 || memcmp(&p[0], "RIFF", 4) != 0 || memcmp(&p[8], "WAVE", 4) != 0) {
+        return 0;
+    }
+
+    // Walk the chunk list, like WavReader, but in memory.
+    for (size_t offset = 12; offset + 8 <= size; ) {
+        const uint8_t *chunk = &p[offset];
+        uint32_t chunk_size = wav_get_u32(&chunk[4]);
+        size_t avail = size - offset - 8;
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            if (chunk_size < 16 || avail < 16) {
+                return 0;
+            }
+            audio_format = wav_get_u16(&chunk[8]);
+            num_channels = wav_get_u16(&chunk[10]);
+            rate = wav_get_u32(&chunk[12]);
+            bits_per_sample = wav_get_u16(&chunk[22]);
+            if (audio_format == WAV_FORMAT_EXTENSIBLE && chunk_size >= 40 && avail >= 40) {
+                // The actual format is at the start of the sub-format GUID.
+                audio_format = wav_get_u16(&chunk[32]);
+            }
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (audio_format != WAV_FORMAT_PCM || num_channels == 0) {
+                return 0;
+            }
+            // The samples are used in place, a truncated image is played up to its end.
+            samples = &chunk[8];
+            n_bytes = (chunk_size < avail) ? chunk_size : avail;
+            return 1;
+        }
+
+        // Chunks are padded to an even size.
+        offset += 8 + chunk_size + (chunk_size & 1);
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+/*
+  This file is part of the Arduino_AdvancedAnalog library.
+  Copyright (c) 2024 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_WAV_IMAGE_H__
+#define __ADVANCED_WAV_IMAGE_H__
+
+#include "AdvancedAnalog.h"
+
+class WavImage {
+    private:
+        const uint8_t *samples;
+        size_t n_bytes;
+        uint16_t num_channels;
+        uint16_t bits_per_sample;
+        uint32_t rate;
+
+    public:
+        WavImage(): samples(nullptr), n_bytes(0), num_channels(0), bits_per_sample(0), rate(0) {
+        }
+
+        size_t channels() {
+            return num_channels;
+        }
+
+        size_t resolution() {
+            return bits_per_sample;
+        }
+
+        size_t sample_rate() {
+            return rate;
+        }
+
+        size_t sample_count() {
+            return bits_per_sample ? (n_bytes * 8) / bits_per_sample : 0;
+        }
+
+        const void *data() {
+            return samples;
+        }
+
+        size_t bytes() {
+            return n_bytes;
+        }
+
+        int begin(const void *image, size_t size);
+};
+
+#endif // __ADVANCED_WAV_IMAGE_H__
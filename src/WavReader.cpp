@@ -18,94 +18,788 @@
 */
 
 #include "Arduino.h"
+#include "mbed.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include "HALConfig.h"
 #include "WavReader.h"
 
+#define WAV_FORMAT_PCM          (0x0001)
+#define WAV_FORMAT_FLOAT        (0x0003)
+#define WAV_FORMAT_IMA_ADPCM    (0x0011)
+#define WAV_FORMAT_EXTENSIBLE   (0xFFFE)
+
+// Read-ahead thread event, set when a buffer is free to be filled, or on stop.
+#define WAV_EVENT_WAKE          (1UL << 0)
+
+static uint32_t WAV_RES_LUT[] = {
+    8, 10, 12, 14, 16
+};
+
+// IMA ADPCM quantizer step sizes, and step index adjustments per 4-bit code.
+static const int16_t IMA_STEP_LUT[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+    12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t IMA_INDEX_LUT[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static inline int16_t ima_decode(int32_t &pred, int32_t &index, uint32_t code) {
+    int32_t step = IMA_STEP_LUT[index];
+    int32_t diff = step >> 3;
+    if (code & 1) {
+        diff += step >> 2;
+    }
+    if (code & 2) {
+        diff += step >> 1;
+    }
+    if (code & 4) {
+        diff += step;
+    }
+    pred = __SSAT((code & 8) ? (pred - diff) : (pred + diff), 16);
+    index += IMA_INDEX_LUT[code];
+    index = (index < 0) ? 0 : ((index > 88) ? 88 : index);
+    return (int16_t) pred;
+}
+
+static size_t ima_block_frames(size_t len, size_t n_channels) {
+    // Each channel has a 4-byte header that holds the first sample, followed by
+    // interleaved groups of 4 bytes (8 samples) per channel.
+    size_t header = 4 * n_channels;
+    return (len < header) ? 0 : (1 + ((len - header) / header) * 8);
+}
+
 WavReader::~WavReader() {
     stop();
 }
 
-int WavReader::begin(const char *path, size_t n_samples, size_t n_buffers, bool loop) {
-    this->loop = loop;
+int WavReader::output(uint32_t resolution, bool is_signed, size_t n_channels, int channel) {
+    // Sanity checks.
+    if (pool != nullptr || resolution >= AN_ARRAY_SIZE(WAV_RES_LUT) ||
+        n_channels > AN_WAV_MAX_CHANNELS || channel < AN_WAV_DOWNMIX) {
+        return 0;
+    }
+
+    // Signed output is only supported for 16-bit PCM (e.g. I2S).
+    if (is_signed && resolution != AN_RESOLUTION_16) {
+        return 0;
+    }
+
+    out_res = resolution;
+    out_signed = is_signed;
+    out_channels = n_channels;
+    out_channel = channel;
+    return 1;
+}
+
+int WavReader::buffer_memory(void *arena, size_t size) {
+    // Must be called before begin().
+    if (pool != nullptr) {
+        return 0;
+    }
+    this->arena = arena;
+    this->arena_size = size;
+    return 1;
+}
+
+int WavReader::parse_chunks(WavFile *file) {
+    char riff[12];
+    if (::read(file->fd, riff, sizeof(riff)) != sizeof(riff) ||
+        memcmp(&riff[0], "RIFF", 4) != 0 || memcmp(&riff[8], "WAVE", 4) != 0) {
+        return 0;
+    }
+
+    // Walk the chunk list, skipping any chunk other than the format and data chunks
+    // (e.g. LIST or fact). The data chunk is expected to be after the format chunk.
+    bool has_format = false;
+    for (off_t offset = sizeof(riff); ; ) {
+        WavChunk chunk;
+        if (::read(file->fd, &chunk, sizeof(chunk)) != sizeof(chunk)) {
+            return 0;
+        }
+        offset += sizeof(chunk);
+
+        if (memcmp(chunk.id, "fmt ", 4) == 0) {
+            uint8_t fmt[40];
+            size_t size = (chunk.size < sizeof(fmt)) ? chunk.size : sizeof(fmt);
+            if (size < sizeof(file->format) || ::read(file->fd, fmt, size) != (ssize_t) size) {
+                return 0;
+            }
+            memcpy(&file->format, fmt, sizeof(file->format));
+            if (file->format.audio_format == WAV_FORMAT_EXTENSIBLE && size == sizeof(fmt)) {
+                // The actual format is at the start of the sub-format GUID.
+                memcpy(&file->format.audio_format, &fmt[24], sizeof(file->format.audio_format));
+            }
+            has_format = true;
+        } else if (memcmp(chunk.id, "data", 4) == 0) {
+            file->data_offset = offset;
+            file->data_size = chunk.size;
+            return has_format;
+        }
+
+        // Chunks are padded to an even size.
+        offset += chunk.size + (chunk.size & 1);
+        if (lseek(file->fd, offset, SEEK_SET) < 0) {
+            return 0;
+        }
+    }
+}
 
-    if ((file = fopen(path, "rb")) == nullptr) {
+int WavReader::open_file(const char *path, WavFile *file, size_t n_channels) {
+    // The file is read with POSIX I/O, bypassing the stdio buffer: samples are read in
+    // large sector-aligned blocks, either straight into the sample buffers, or through
+    // the block cache, which is then scattered into several sample buffers.
+    if ((file->fd = open(path, O_RDONLY)) < 0) {
         return 0;
     }
 
-    // Read file header
-    fread(&header, sizeof(header), 1, file);
+    // Find the format and data chunks, and check that the format is supported.
+    if (!parse_chunks(file) || !check_format(file->format, n_channels)) {
+        close(file->fd);
+        file->fd = -1;
+        return 0;
+    }
+    return 1;
+}
 
+int WavReader::check_format(const WavFormat &fmt, size_t n_channels) {
     // Add more sanity checks if needed.
-    if (memcmp(header.chunk_id, "RIFF", 4) != 0 ||
-        memcmp(header.format, "WAVEfmt", 7) != 0 ||
-        ((sizeof(Sample) * 8) < header.bits_per_sample) ||
-        (n_samples * header.num_channels) > sample_count()) {
+    uint32_t bits = fmt.bits_per_sample;
+    if (!(fmt.audio_format == WAV_FORMAT_PCM && (bits == 8 || bits == 16 || bits == 24 || bits == 32)) &&
+        !(fmt.audio_format == WAV_FORMAT_FLOAT && bits == 32) &&
+        !(fmt.audio_format == WAV_FORMAT_IMA_ADPCM && bits == 4)) {
+        return 0;
+    }
+
+    size_t n_out = n_channels ? n_channels : fmt.num_channels;
+    if (fmt.num_channels == 0 || n_out > AN_WAV_MAX_CHANNELS || out_channel >= fmt.num_channels) {
+        return 0;
+    }
+
+    if (fmt.audio_format == WAV_FORMAT_IMA_ADPCM) {
+        // IMA ADPCM data is decoded in whole blocks, which hold a header per channel
+        // followed by groups of 4 bytes per channel.
+        return fmt.num_channels <= AN_WAV_MAX_CHANNELS && fmt.block_align <= AN_WAV_CACHE_SIZE &&
+               fmt.block_align >= (4 * fmt.num_channels) && (fmt.block_align % (4 * fmt.num_channels)) == 0;
+    }
+    return fmt.block_align == (fmt.num_channels * bits / 8);
+}
+
+bool WavReader::is_raw(const WavFormat &fmt) {
+    // Signed 16-bit files are read as is, unless the channels have to be remapped.
+    return fmt.audio_format == WAV_FORMAT_PCM && fmt.bits_per_sample == 16 && out_signed &&
+           (out_channels == 0 || out_channels == fmt.num_channels) && out_channel < 0;
+}
+
+int WavReader::alloc_convert(const WavFormat &fmt) {
+    // Any other format is converted in blocks of frames, or decoded one ADPCM block
+    // at a time. The buffers only grow, so they fit all of the queued files.
+    if (is_raw(fmt)) {
+        return 1;
+    }
+
+    size_t n_frames = AN_WAV_CONVERT_FRAMES;
+    size_t n_bytes = AN_WAV_CONVERT_FRAMES * fmt.block_align;
+    if (fmt.audio_format == WAV_FORMAT_IMA_ADPCM) {
+        n_frames = ima_block_frames(fmt.block_align, fmt.num_channels);
+        n_bytes = fmt.block_align;
+    }
+
+    // When a file is queued, the current file may still be playing from the decoded
+    // frames, so the new buffers are allocated before the old ones are freed, and the
+    // pending frames are copied across. If an allocation fails, the old buffers are kept.
+    size_t n_pcm = n_frames * fmt.num_channels;
+    uint8_t *new_scratch = nullptr;
+    int16_t *new_pcm = nullptr;
+    if (n_bytes > scratch_size && (new_scratch = new uint8_t[n_bytes]) == nullptr) {
+        return 0;
+    }
+
+    if (n_pcm > pcm_size && (new_pcm = new int16_t[n_pcm]) == nullptr) {
+        if (new_scratch) {
+            delete [] new_scratch;
+        }
+        return 0;
+    }
+
+    if (new_scratch) {
+        if (scratch) {
+            delete [] scratch;
+        }
+        scratch = new_scratch;
+        scratch_size = n_bytes;
+    }
+
+    if (new_pcm) {
+        if (pcm) {
+            size_t n_pending = pcm_len * format.num_channels;
+            memcpy(new_pcm, pcm, ((n_pending < pcm_size) ? n_pending : pcm_size) * sizeof(int16_t));
+            delete [] pcm;
+        }
+        pcm = new_pcm;
+        pcm_size = n_pcm;
+    }
+    return 1;
+}
+
+void WavReader::use_file(WavFile *file) {
+    close_file();
+    fd = file->fd;
+    loop = file->loop;
+    format = file->format;
+    data_offset = file->data_offset;
+    data_size = file->data_size;
+    file->fd = -1;
+
+    raw = is_raw(format);
+    block_frames = 0;
+    if (format.audio_format == WAV_FORMAT_IMA_ADPCM) {
+        block_frames = ima_block_frames(format.block_align, format.num_channels);
+    }
+
+    // The loop region is reset to the whole file.
+    loop_start = loop_end = 0;
+    data_end = data_size;
+
+    // Output channels are mapped to the same file channel, or wrap around the file's
+    // channels, so a mono file drives all outputs.
+    size_t n_channels = out_channels ? out_channels : format.num_channels;
+    for (size_t i=0; i<n_channels; i++) {
+        out_map[i] = (out_channel >= 0) ? out_channel : (i % format.num_channels);
+    }
+}
+
+int WavReader::next_file() {
+    // Switch to the queued file, which was opened and parsed when it was queued, so
+    // its first samples follow the last samples of the current file.
+    if (next.fd < 0) {
+        return 0;
+    }
+    use_file(&next);
+    return seek_data(0);
+}
+
+int WavReader::begin(const char *path, size_t n_samples, size_t n_buffers, bool loop, bool read_ahead) {
+    WavFile file;
+    file.loop = loop;
+    if (!open_file(path, &file, out_channels)) {
+        return 0;
+    }
+    use_file(&file);
+
+    size_t n_channels = out_channels ? out_channels : format.num_channels;
+    if ((n_samples * format.num_channels) > sample_count()) {
         stop();
         return 0;
     }
 
-    // Allocate the DMA buffer pool.
-    pool = new DMAPool<Sample>(n_samples, header.num_channels, n_buffers);
-    if (pool == nullptr) {
+    // Allocate the DMA buffer pool and the block cache.
+    hal_dma_arena_t mem = {(uint8_t *) arena, arena_size};
+    pool = hal_dma_pool_new<Sample>(n_samples, n_channels, n_buffers, AN_DMA_MEM_CACHED, &mem);
+    cache = new uint8_t[AN_WAV_CACHE_SIZE];
+    if (pool == nullptr || cache == nullptr || !seek_data(0) || !alloc_convert(format)) {
         stop();
         return 0;
     }
+
+    if (read_ahead) {
+        // Start the read-ahead thread, which keeps all of the free buffers filled. It runs
+        // above the sketch's priority, so it can catch up as soon as a read completes.
+        // The file position after each filled buffer is kept until the buffer is read, so
+        // position() reports the playback position rather than the thread's position. At
+        // most n_buffers buffers are filled ahead of the last one read.
+        mutex = new rtos::Mutex();
+        events = new rtos::EventFlags();
+        fill_len = n_buffers + 1;
+        fill_pos = new size_t[fill_len];
+        thread = new rtos::Thread(osPriorityAboveNormal, AN_WAV_THREAD_STACK);
+        if (mutex == nullptr || events == nullptr || fill_pos == nullptr || thread == nullptr) {
+            stop();
+            return 0;
+        }
+        n_filled = n_read = 0;
+        fill_pos[0] = file_position();
+        running = true;
+        if (thread->start(mbed::callback(this, &WavReader::worker)) != osOK) {
+            running = false;
+            stop();
+            return 0;
+        }
+    }
     return 1;
 }
 
 void WavReader::stop() {
-    if (file) {
-        fclose(file);
+    if (thread) {
+        running = false;
+        if (events) {
+            events->set(WAV_EVENT_WAKE);
+        }
+        thread->join();
+        delete thread;
+    }
+    if (mutex) {
+        delete mutex;
+    }
+    if (events) {
+        delete events;
+    }
+    if (fill_pos) {
+        delete [] fill_pos;
     }
     if (pool) {
-        delete pool;
+        hal_dma_pool_delete(pool);
+    }
+    if (cache) {
+        delete [] cache;
+    }
+    if (scratch) {
+        delete [] scratch;
+    }
+    if (pcm) {
+        delete [] pcm;
+    }
+    if (next.fd >= 0) {
+        close(next.fd);
     }
+    close_file();
+    next.fd = -1;
+    scratch_size = 0;
+    pcm_size = 0;
     pool = nullptr;
-    file = nullptr;
+    cache = nullptr;
+    scratch = nullptr;
+    pcm = nullptr;
+    thread = nullptr;
+    mutex = nullptr;
+    events = nullptr;
+    fill_pos = nullptr;
+    fill_len = 0;
+}
+
+void WavReader::close_file() {
+    if (fd >= 0) {
+        close(fd);
+    }
+    fd = -1;
 }
 
 bool WavReader::available() {
-    if (file != nullptr && pool != nullptr) {
+    if (thread != nullptr) {
+        // Buffers released by the sketch since the last call are free to be filled,
+        // so wake up the read-ahead thread. Buffers are ready as soon as it has filled them.
+        if (pool->writable()) {
+            events->set(WAV_EVENT_WAKE);
+        }
+        return pool->readable();
+    }
+    if (fd >= 0 && pool != nullptr) {
         return pool->writable();
     }
     return false;
 }
 
-DMABuffer<Sample> &WavReader::read() {
-    while (!available()) {
-        __WFI();
+size_t WavReader::read_data(uint8_t *dst, size_t len) {
+    if (cache_off == cache_len) {
+        if (skip == 0 && len >= AN_WAV_SECTOR_SIZE) {
+            // The file offset is aligned, so whole sectors are read straight into the buffer.
+            ssize_t n = ::read(fd, dst, len & ~(AN_WAV_SECTOR_SIZE - 1));
+            return (n > 0) ? n : 0;
+        }
+
+        // Refill the cache. After a seek, the head of the first block is skipped.
+        ssize_t n = ::read(fd, cache, AN_WAV_CACHE_SIZE);
+        if (n <= (ssize_t) skip) {
+            return 0;
+        }
+        cache_len = n;
+        cache_off = skip;
+        skip = 0;
     }
 
-    DMABuffer<Sample> *buf = pool->alloc(DMA_BUFFER_WRITE);
+    size_t n = cache_len - cache_off;
+    n = (n < len) ? n : len;
+    memcpy(dst, &cache[cache_off], n);
+    cache_off += n;
+    return n;
+}
+
+size_t WavReader::data_left() {
+    // In loop mode, data is read up to the end of the loop region, unless the read
+    // position was moved past it.
+    size_t end = (loop && data_pos <= data_end) ? data_end : data_size;
+    return end - data_pos;
+}
+
+size_t WavReader::read_frames(uint8_t *dst, size_t len) {
     size_t offset = 0;
-    Sample *rawbuf = buf->data();
-    size_t n_samples = buf->size();
-
-    while (offset < n_samples) {
-        offset += fread(&rawbuf[offset], sizeof(Sample), n_samples - offset, file);
-        if (offset < n_samples) {
-            if (loop) {
-                rewind();
-            } else {
-                for (size_t i=offset; i<n_samples; i++) {
-                    rawbuf[i] = 0;
+    while (offset < len) {
+        // Loop back to the start of the loop region, unless the next file is queued.
+        if (data_left() == 0 && loop && next.fd < 0 && seek_frame(loop_start)) {
+            continue;
+        }
+
+        size_t n = len - offset;
+        size_t left = data_left();
+        n = left ? read_data(&dst[offset], (n < left) ? n : left) : 0;
+        if (n == 0) {
+            // End of data, or a read error.
+            break;
+        }
+        offset += n;
+        data_pos += n;
+    }
+    return offset;
+}
+
+size_t WavReader::decode_block(const uint8_t *src, size_t len) {
+    int32_t pred[AN_WAV_MAX_CHANNELS];
+    int32_t index[AN_WAV_MAX_CHANNELS];
+    size_t n_ch = format.num_channels;
+    size_t n_frames = ima_block_frames(len, n_ch);
+
+    for (size_t c=0; c<n_ch && n_frames; c++) {
+        pred[c] = (int16_t) (src[c * 4] | (src[c * 4 + 1] << 8));
+        index[c] = (src[c * 4 + 2] > 88) ? 88 : src[c * 4 + 2];
+        pcm[c] = (int16_t) pred[c];
+    }
+
+    // Codes are packed low nibble first, in groups of 8 samples per channel.
+    src += 4 * n_ch;
+    for (size_t frame=1; frame<n_frames; frame+=8) {
+        for (size_t c=0; c<n_ch; c++) {
+            int16_t *dst = &pcm[frame * n_ch + c];
+            for (size_t i=0; i<8; i+=2, src++) {
+                dst[i * n_ch] = ima_decode(pred[c], index[c], *src & 0x0F);
+                dst[(i + 1) * n_ch] = ima_decode(pred[c], index[c], *src >> 4);
+            }
+        }
+    }
+    return n_frames;
+}
+
+size_t WavReader::decode(size_t n_frames, const int16_t **src) {
+    if (block_frames) {
+        // Decode the next ADPCM block once the current one is used up. Blocks are read
+        // one at a time, so a short last block doesn't wrap around when looping.
+        if (pcm_off == pcm_len) {
+            if (data_left() == 0 && loop && next.fd < 0) {
+                seek_frame(loop_start);
+            }
+            size_t len = data_left();
+            len = (len < format.block_align) ? len : format.block_align;
+            block_pos = (data_pos / format.block_align) * block_frames;
+            pcm_len = decode_block(scratch, read_frames(scratch, len));
+            if (loop && loop_end > block_pos && loop_end < block_pos + pcm_len) {
+                // The loop region ends in this block.
+                pcm_len = loop_end - block_pos;
+            }
+            pcm_off = (pcm_skip < pcm_len) ? pcm_skip : pcm_len;
+            pcm_skip = 0;
+        }
+        n_frames = (n_frames < (pcm_len - pcm_off)) ? n_frames : (pcm_len - pcm_off);
+        *src = &pcm[pcm_off * format.num_channels];
+        pcm_off += n_frames;
+        return n_frames;
+    }
+
+    n_frames = (n_frames < AN_WAV_CONVERT_FRAMES) ? n_frames : AN_WAV_CONVERT_FRAMES;
+    n_frames = read_frames(scratch, n_frames * format.block_align) / format.block_align;
+    *src = pcm;
+
+    // Decode the samples to signed 16-bit, with one loop per format.
+    const uint8_t *raw = scratch;
+    size_t n = n_frames * format.num_channels;
+    if (format.audio_format == WAV_FORMAT_FLOAT) {
+        for (size_t i=0; i<n; i++) {
+            float f;
+            memcpy(&f, &raw[i * 4], sizeof(f));
+            pcm[i] = (int16_t) __SSAT((int32_t) (f * 32768.0f), 16);
+        }
+    } else if (format.bits_per_sample == 8) {
+        for (size_t i=0; i<n; i++) {
+            pcm[i] = (int16_t) ((raw[i] ^ 0x80) << 8);
+        }
+    } else {
+        // Keep the 16 most significant bits of 16, 24 and 32-bit samples.
+        size_t size = format.bits_per_sample / 8;
+        for (size_t i=0, j=size-2; i<n; i++, j+=size) {
+            pcm[i] = (int16_t) (raw[j] | (raw[j + 1] << 8));
+        }
+    }
+    return n_frames;
+}
+
+size_t WavReader::convert(DMABuffer<Sample> *buf, size_t frame) {
+    Sample *out = buf->data();
+    size_t n_in = format.num_channels;
+    size_t n_out = buf->channels();
+    size_t n_frames = buf->size() / n_out;
+    uint32_t shift = 16 - WAV_RES_LUT[out_res];
+    uint32_t flip = out_signed ? 0 : 0x8000;
+    bool downmix = (n_out == 1 && n_in > 1 && out_channel == AN_WAV_DOWNMIX);
+
+    if (raw) {
+        // Signed 16-bit frames are read straight into the buffer.
+        size_t len = read_frames((uint8_t *) &out[frame * n_out], (n_frames - frame) * format.block_align);
+        return len / format.block_align;
+    }
+
+    size_t start = frame;
+    while (frame < n_frames) {
+        const int16_t *src;
+        size_t n_read = decode(n_frames - frame, &src);
+        if (n_read == 0) {
+            return frame - start;
+        }
+
+        // Map the channels, then convert to the output resolution: unsigned samples
+        // are flipped to mid-scale and right-aligned.
+        Sample *dst = &out[frame * n_out];
+        if (downmix) {
+            for (size_t i=0; i<n_read; i++) {
+                int32_t sum = 0;
+                for (size_t c=0; c<n_in; c++) {
+                    sum += src[i * n_in + c];
+                }
+                dst[i] = (Sample) (((uint16_t) (sum / (int32_t) n_in) ^ flip) >> shift);
+            }
+        } else {
+            for (size_t i=0; i<n_read; i++) {
+                for (size_t c=0; c<n_out; c++) {
+                    dst[i * n_out + c] = (Sample) (((uint16_t) src[i * n_in + out_map[c]] ^ flip) >> shift);
                 }
-                fclose(file);
-                file = nullptr;
-                break;
             }
         }
+        frame += n_read;
+    }
+    return n_frames - start;
+}
+
+int WavReader::fill(DMABuffer<Sample> *buf) {
+    size_t n_frames = buf->size() / buf->channels();
+    size_t frame = 0;
+    while (true) {
+        frame += convert(buf, frame);
+        if (frame == n_frames) {
+            return 1;
+        }
+        // End of data: continue with the next file, if one is queued.
+        if (!next_file()) {
+            break;
+        }
+    }
+
+    // Fill the rest of the buffer with silence.
+    Sample silence = (Sample) ((out_signed ? 0 : 0x8000) >> (16 - WAV_RES_LUT[out_res]));
+    for (size_t i=frame * buf->channels(); i<buf->size(); i++) {
+        buf->data()[i] = silence;
+    }
+    close_file();
+    return 0;
+}
+
+void WavReader::worker() {
+    while (running) {
+        if (!pool->writable()) {
+            // Wait for the sketch to release a buffer. The thread is woken up when the
+            // sketch next calls available() or read(), after a seek, and on stop().
+            events->wait_any(WAV_EVENT_WAKE);
+            continue;
+        }
+
+        mutex->lock();
+        DMABuffer<Sample> *buf = pool->alloc(DMA_BUFFER_WRITE);
+        int ret = fill(buf);
+        fill_pos[++n_filled % fill_len] = file_position();
+        // Releasing a write buffer queues it for reading.
+        buf->release();
+        mutex->unlock();
+
+        if (ret == 0) {
+            // End of file, the remaining buffers can still be read.
+            break;
+        }
     }
+}
+
+DMABuffer<Sample> &WavReader::read() {
+    while (!available()) {
+        __WFI();
+    }
+
+    if (thread != nullptr) {
+        // NOTE: n_read is only updated from the sketch's thread.
+        n_read++;
+        return *pool->alloc(DMA_BUFFER_READ);
+    }
+
+    DMABuffer<Sample> *buf = pool->alloc(DMA_BUFFER_WRITE);
+    fill(buf);
     buf->clr_flags();
     buf->set_flags(DMA_BUFFER_READ);
     return *buf;
 }
 
-int WavReader::rewind() {
-    if (file == nullptr) {
+int WavReader::seek_data(size_t offset) {
+    if (fd < 0 || offset > data_size) {
         return 0;
     }
-    if (fseek(file, sizeof(WavHeader), SEEK_SET) == -1) {
+
+    // Seek to the sector that holds the requested data, and drop the cache.
+    offset += data_offset;
+    if (lseek(fd, offset & ~(AN_WAV_SECTOR_SIZE - 1), SEEK_SET) < 0) {
         return 0;
     }
+    skip = offset & (AN_WAV_SECTOR_SIZE - 1);
+    cache_len = cache_off = 0;
+    pcm_len = pcm_off = pcm_skip = 0;
+    data_pos = offset - data_offset;
     return 1;
 }
+
+int WavReader::rewind() {
+    return seek(0);
+}
+
+size_t WavReader::frame_offset(size_t frame, size_t *n_skip) {
+    // ADPCM data is seeked to the start of the block that holds the frame, and the
+    // frames before it are skipped once the block is decoded.
+    if (block_frames) {
+        *n_skip = frame % block_frames;
+        return (frame / block_frames) * format.block_align;
+    }
+    *n_skip = 0;
+    return frame * format.block_align;
+}
+
+int WavReader::seek_frame(size_t frame) {
+    size_t n_skip;
+    int ret = seek_data(frame_offset(frame, &n_skip));
+    pcm_skip = n_skip;
+    return ret;
+}
+
+int WavReader::seek(size_t sample) {
+    if (mutex == nullptr) {
+        return seek_frame(sample);
+    }
+
+    mutex->lock();
+    int ret = seek_frame(sample);
+    if (ret) {
+        // Drop the buffers that were read ahead from the old position.
+        pool->flush();
+        n_filled = n_read;
+        fill_pos[n_read % fill_len] = file_position();
+        events->set(WAV_EVENT_WAKE);
+    }
+    mutex->unlock();
+    return ret;
+}
+
+int WavReader::loop_region(size_t start, size_t end) {
+    size_t n_frames = (fd < 0) ? 0 : (sample_count() / format.num_channels);
+    if (start >= n_frames || end > n_frames || (end && start >= end)) {
+        return 0;
+    }
+
+    if (mutex) {
+        mutex->lock();
+    }
+
+    // The region's end is rounded up to a whole ADPCM block, and the last block is
+    // cut short once it's decoded. Buffers that were already read ahead are kept, so
+    // a new region takes effect seamlessly.
+    loop = true;
+    loop_start = start;
+    loop_end = end;
+    data_end = data_size;
+    if (end && block_frames) {
+        size_t n_blocks = (end + block_frames - 1) / block_frames;
+        data_end = (n_blocks * format.block_align < data_size) ? (n_blocks * format.block_align) : data_size;
+    } else if (end) {
+        data_end = end * format.block_align;
+    }
+
+    if (mutex) {
+        mutex->unlock();
+    }
+    return 1;
+}
+
+int WavReader::queue(const char *path, bool loop) {
+    // Only one file can be queued, and it's opened and parsed now, so switching to it
+    // doesn't stall the current file. It must have the same number of output channels,
+    // and the same sample rate, as the DAC or I2S clock isn't changed on the switch.
+    if (pool == nullptr || next.fd >= 0) {
+        return 0;
+    }
+
+    WavFile file;
+    file.loop = loop;
+    if (!open_file(path, &file, out_channels)) {
+        return 0;
+    }
+
+    if (mutex) {
+        mutex->lock();
+    }
+    int ret = (out_channels || file.format.num_channels == format.num_channels) &&
+              file.format.sample_rate == format.sample_rate && alloc_convert(file.format);
+    if (ret) {
+        next = file;
+    } else {
+        close(file.fd);
+    }
+    if (mutex) {
+        mutex->unlock();
+    }
+    return ret;
+}
+
+bool WavReader::queued() {
+    return next.fd >= 0;
+}
+
+size_t WavReader::position() {
+    if (mutex == nullptr) {
+        return file_position();
+    }
+
+    // In read-ahead mode, the thread is ahead of playback, so the position after the
+    // last buffer returned by read() is reported instead.
+    mutex->lock();
+    size_t pos = fill_pos[n_read % fill_len];
+    mutex->unlock();
+    return pos;
+}
+
+size_t WavReader::file_position() {
+    if (fd < 0 || format.block_align == 0) {
+        return 0;
+    }
+    if (block_frames) {
+        if (pcm_len) {
+            return block_pos + pcm_off;
+        }
+        return (data_pos / format.block_align) * block_frames + pcm_skip;
+    }
+    return data_pos / format.block_align;
+}
+
+size_t WavReader::sample_count() {
+    if (block_frames) {
+        size_t tail = data_size % format.block_align;
+        size_t n_frames = (data_size / format.block_align) * block_frames +
+                          ima_block_frames(tail, format.num_channels);
+        return n_frames * format.num_channels;
+    }
+    return (data_size * 8) / format.bits_per_sample;
+}
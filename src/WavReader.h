@@ -22,53 +22,145 @@
 
 #include "AdvancedAnalog.h"
 
+namespace rtos {
+class Thread;
+class Mutex;
+class EventFlags;
+}
+
+// Stack size of the read-ahead thread.
+#define AN_WAV_THREAD_STACK     (4096)
+// Storage sector size. All reads start at a sector-aligned file offset.
+#define AN_WAV_SECTOR_SIZE      (512)
+// Size of the block cache, which must be a multiple of the sector size.
+#define AN_WAV_CACHE_SIZE       (8192)
+// Maximum number of output channels, and number of frames converted at once.
+#define AN_WAV_MAX_CHANNELS     (8)
+#define AN_WAV_CONVERT_FRAMES   (128)
+// Output channel selection: mix all of the file's channels down.
+#define AN_WAV_DOWNMIX          (-1)
+
 class WavReader {
     typedef struct {
-        char chunk_id[4];
-        unsigned int chunk_size;
-        char format[4];
-        char subchunk1_id[4];
-        unsigned int subchunk1_size;
-        unsigned short audio_format;
-        unsigned short num_channels;
-        unsigned int sample_rate;
-        unsigned int byte_rate;
-        unsigned short block_align;
-        unsigned short bits_per_sample;
-        char subchunk2_id[4];
-        unsigned int subchunk2_size;
-    } WavHeader;
+        char id[4];
+        uint32_t size;
+    } WavChunk;
+
+    typedef struct {
+        uint16_t audio_format;
+        uint16_t num_channels;
+        uint32_t sample_rate;
+        uint32_t byte_rate;
+        uint16_t block_align;
+        uint16_t bits_per_sample;
+    } WavFormat;
+
+    typedef struct {
+        int fd;
+        bool loop;
+        WavFormat format;
+        uint32_t data_offset;
+        uint32_t data_size;
+    } WavFile;
 
     private:
-        FILE *file;
+        int fd;
         bool loop;
-        WavHeader header;
+        WavFormat format;
+        uint32_t data_offset;
+        uint32_t data_size;
+        uint32_t data_end;
+        size_t loop_start;
+        size_t loop_end;
+        WavFile next;
         DMAPool<Sample> *pool;
+        void *arena;
+        size_t arena_size;
+        rtos::Thread *thread;
+        rtos::Mutex *mutex;
+        rtos::EventFlags *events;
+        size_t *fill_pos;
+        size_t fill_len;
+        size_t n_filled;
+        size_t n_read;
+        volatile bool running;
+        uint8_t *cache;
+        size_t cache_len;
+        size_t cache_off;
+        size_t skip;
+        size_t data_pos;
+        uint32_t out_res;
+        bool out_signed;
+        size_t out_channels;
+        int out_channel;
+        uint8_t out_map[AN_WAV_MAX_CHANNELS];
+        bool raw;
+        uint8_t *scratch;
+        size_t scratch_size;
+        int16_t *pcm;
+        size_t pcm_size;
+        size_t pcm_len;
+        size_t pcm_off;
+        size_t pcm_skip;
+        size_t block_frames;
+        size_t block_pos;
+        void close_file();
+        int open_file(const char *path, WavFile *file, size_t n_channels);
+        int parse_chunks(WavFile *file);
+        int check_format(const WavFormat &fmt, size_t n_channels);
+        bool is_raw(const WavFormat &fmt);
+        int alloc_convert(const WavFormat &fmt);
+        void use_file(WavFile *file);
+        int next_file();
+        size_t data_left();
+        size_t read_data(uint8_t *dst, size_t len);
+        size_t read_frames(uint8_t *dst, size_t len);
+        size_t decode(size_t n_frames, const int16_t **src);
+        size_t decode_block(const uint8_t *src, size_t len);
+        size_t convert(DMABuffer<Sample> *buf, size_t frame);
+        int seek_data(size_t offset);
+        size_t frame_offset(size_t frame, size_t *n_skip);
+        int seek_frame(size_t frame);
+        size_t file_position();
+        int fill(DMABuffer<Sample> *buf);
+        void worker();
 
     public:
-        WavReader(): file(nullptr), loop(false), pool(nullptr) {
+        WavReader(): fd(-1), loop(false), data_offset(0), data_size(0), data_end(0), loop_start(0), loop_end(0),
+            pool(nullptr), arena(nullptr), arena_size(0), thread(nullptr), mutex(nullptr), events(nullptr), fill_pos(nullptr), fill_len(0),
+            n_filled(0), n_read(0), running(false),
+            cache(nullptr), cache_len(0), cache_off(0), skip(0), data_pos(0), out_res(AN_RESOLUTION_16),
+            out_signed(true), out_channels(0), out_channel(AN_WAV_DOWNMIX), raw(false), scratch(nullptr),
+            scratch_size(0), pcm(nullptr), pcm_size(0), pcm_len(0), pcm_off(0), pcm_skip(0), block_frames(0),
+            block_pos(0) {
+            next.fd = -1;
         }
         ~WavReader();
         size_t channels() {
-            return header.num_channels;
+            return format.num_channels;
         }
 
         size_t resolution() {
-            return header.bits_per_sample;
+            return format.bits_per_sample;
         }
 
         size_t sample_rate() {
-            return header.sample_rate;
+            return format.sample_rate;
         }
 
-        size_t sample_count() {
-            return (header.subchunk2_size * 8) / header.bits_per_sample;
-        }
+        size_t sample_count();
 
-        int begin(const char *path, size_t n_samples, size_t n_buffers, bool loop=false);
+        int output(uint32_t resolution, bool is_signed, size_t n_channels=0, int channel=AN_WAV_DOWNMIX);
+        int buffer_memory(void *arena, size_t size);
+        int begin(const char *path, size_t n_samples, size_t n_buffers, bool loop=false, bool read_ahead=false);
         void stop();
         bool available();
         SampleBuffer read();
         int rewind();
+        int seek(size_t sample);
+        size_t position();
+        int loop_region(size_t start, size_t end);
+        int queue(const char *path, bool loop=false);
+        bool queued();
 };
 #endif // __ADVANCED_WAV_READER_H__
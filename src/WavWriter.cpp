@@ -0,0 +1,213 @@
+/*
+  This file is part of the Arduino_AdvancedAnalog library.
+  Copyright (c) 2024 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Arduino.h"
+#include "mbed.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include "WavWriter.h"
+
+// The header is padded with a JUNK chunk to a whole sector, so all data writes
+// start at a sector-aligned file offset.
+#define WAV_HEADER_SIZE     (AN_WAV_SECTOR_SIZE)
+
+// Wakes the writer thread when a whole block is queued, or when it must exit.
+#define WAV_EVENT_WAKE      (1UL << 0)
+
+static uint32_t WAV_RES_LUT[] = {
+    8, 10, 12, 14, 16
+};
+
+static void wav_put_chunk(uint8_t *hdr, const char *id, uint32_t size) {
+    memcpy(&hdr[0], id, 4);
+    memcpy(&hdr[4], &size, 4);
+}
+
+WavWriter::~WavWriter() {
+    stop();
+}
+
+int WavWriter::begin(const char *path, uint32_t sample_rate, size_t n_channels,
+                     uint32_t resolution, bool is_signed, size_t n_blocks) {
+    // Sanity checks.
+    if (fd >= 0 || n_channels == 0 || n_blocks == 0 || resolution >= AN_ARRAY_SIZE(WAV_RES_LUT)) {
+        return 0;
+    }
+
+    // Signed input is only supported for 16-bit PCM (e.g. I2S).
+    if (is_signed && resolution != AN_RESOLUTION_16) {
+        return 0;
+    }
+
+    if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC)) < 0) {
+        return 0;
+    }
+
+    // Samples are always written as signed 16-bit PCM: unsigned samples are left-aligned
+    // and their sign bit is flipped, which moves mid-scale to zero.
+    this->sample_rate = sample_rate;
+    this->n_channels = n_channels;
+    this->shift = 16 - WAV_RES_LUT[resolution];
+    this->flip = is_signed ? 0 : 0x8000;
+    this->head = 0;
+    this->tail = 0;
+    this->error = false;
+    this->data_size = 0;
+
+    // Samples are queued in a ring of blocks, and written one block at a time.
+    ring_size = n_blocks * AN_WAV_CACHE_SIZE;
+    ring = new uint8_t[ring_size];
+    if (ring == nullptr || !write_header()) {
+        stop();
+        return 0;
+    }
+
+    // Start the writer thread. It runs above the sketch's priority, so it can keep up
+    // with the capture, but it only runs when a block is ready.
+    events = new rtos::EventFlags();
+    thread = new rtos::Thread(osPriorityAboveNormal, AN_WAV_THREAD_STACK);
+    if (events == nullptr || thread == nullptr) {
+        stop();
+        return 0;
+    }
+    running = true;
+    if (thread->start(mbed::callback(this, &WavWriter::worker)) != osOK) {
+        running = false;
+        stop();
+        return 0;
+    }
+    return 1;
+}
+
+size_t WavWriter::used() {
+    return (head + 2 * ring_size - tail) % (2 * ring_size);
+}
+
+int WavWriter::write(SampleBuffer buf) {
+    size_t n_bytes = buf.bytes();
+    if (fd < 0 || error || !buf || buf.channels() != n_channels || (ring_size - used()) < n_bytes) {
+        return 0;
+    }
+
+    Sample *data = buf.data();
+    size_t idx = head % ring_size;
+    for (size_t i=0; i<buf.size(); i++) {
+        *((uint16_t *) &ring[idx]) = (uint16_t) ((data[i] << shift) ^ flip);
+        idx += sizeof(uint16_t);
+        if (idx == ring_size) {
+            idx = 0;
+        }
+    }
+
+    // Make sure the samples are stored before the writer thread can see them.
+    __DMB();
+    head = (head + n_bytes) % (2 * ring_size);
+    // Wake the writer thread once a whole block is queued. This is checked after every
+    // write rather than on the crossing alone, as the thread may be draining the ring.
+    if (used() >= AN_WAV_CACHE_SIZE) {
+        events->set(WAV_EVENT_WAKE);
+    }
+    return 1;
+}
+
+int WavWriter::write_ring(size_t len) {
+    size_t idx = tail % ring_size;
+    if (::write(fd, &ring[idx], len) != (ssize_t) len) {
+        return 0;
+    }
+    data_size += len;
+    tail = (tail + len) % (2 * ring_size);
+    return 1;
+}
+
+int WavWriter::write_header() {
+    uint8_t hdr[WAV_HEADER_SIZE] = { 0 };
+    uint16_t fmt[8] = { 0 };
+    uint32_t byte_rate = sample_rate * n_channels * sizeof(uint16_t);
+
+    fmt[0] = 1;     // PCM
+    fmt[1] = n_channels;
+    memcpy(&fmt[2], &sample_rate, 4);
+    memcpy(&fmt[4], &byte_rate, 4);
+    fmt[6] = n_channels * sizeof(uint16_t);
+    fmt[7] = 16;
+
+    wav_put_chunk(&hdr[0], "RIFF", WAV_HEADER_SIZE - 8 + data_size);
+    memcpy(&hdr[8], "WAVE", 4);
+    wav_put_chunk(&hdr[12], "fmt ", sizeof(fmt));
+    memcpy(&hdr[20], fmt, sizeof(fmt));
+    wav_put_chunk(&hdr[36], "JUNK", WAV_HEADER_SIZE - 52);
+    wav_put_chunk(&hdr[WAV_HEADER_SIZE - 8], "data", data_size);
+
+    if (lseek(fd, 0, SEEK_SET) < 0 || ::write(fd, hdr, sizeof(hdr)) != sizeof(hdr)) {
+        return 0;
+    }
+    return 1;
+}
+
+void WavWriter::worker() {
+    while (running) {
+        if (used() < AN_WAV_CACHE_SIZE) {
+            // Wait for the sketch to queue a whole block.
+            events->wait_any(WAV_EVENT_WAKE);
+            continue;
+        }
+
+        if (!write_ring(AN_WAV_CACHE_SIZE)) {
+            error = true;
+            break;
+        }
+    }
+}
+
+int WavWriter::stop() {
+    int ret = 0;
+
+    if (thread) {
+        running = false;
+        if (events) {
+            events->set(WAV_EVENT_WAKE);
+        }
+        thread->join();
+        delete thread;
+    }
+
+    if (fd >= 0) {
+        ret = !error;
+        // Write the remaining data, then patch the header with the final sizes.
+        while (ret && ring && used()) {
+            size_t len = ring_size - (tail % ring_size);
+            ret = write_ring((used() < len) ? used() : len);
+        }
+        ret = write_header() && ret;
+        close(fd);
+    }
+
+    if (events) {
+        delete events;
+    }
+    if (ring) {
+        delete [] ring;
+    }
+    fd = -1;
+    ring = nullptr;
+    thread = nullptr;
+    events = nullptr;
+    return ret;
+}
@@ -0,0 +1,60 @@
+/*
+  This file is part of the Arduino_AdvancedAnalog library.
+  Copyright (c) 2024 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_WAV_WRITER_H__
+#define __ADVANCED_WAV_WRITER_H__
+
+#include "AdvancedAnalog.h"
+#include "WavReader.h"
+
+class WavWriter {
+    private:
+        int fd;
+        uint32_t sample_rate;
+        size_t n_channels;
+        uint32_t shift;
+        uint32_t flip;
+        uint8_t *ring;
+        size_t ring_size;
+        // Read and write offsets, modulo twice the ring size, so a full ring
+        // can be told apart from an empty one.
+        volatile size_t head;
+        volatile size_t tail;
+        volatile bool running;
+        volatile bool error;
+        uint32_t data_size;
+        rtos::Thread *thread;
+        rtos::EventFlags *events;
+        size_t used();
+        int write_ring(size_t len);
+        int write_header();
+        void worker();
+
+    public:
+        WavWriter(): fd(-1), sample_rate(0), n_channels(0), shift(0), flip(0), ring(nullptr), ring_size(0),
+            head(0), tail(0), running(false), error(false), data_size(0), thread(nullptr), events(nullptr) {
+        }
+        ~WavWriter();
+        int begin(const char *path, uint32_t sample_rate, size_t n_channels,
+                  uint32_t resolution=AN_RESOLUTION_16, bool is_signed=true, size_t n_blocks=8);
+        int write(SampleBuffer buf);
+        int stop();
+};
+
+#endif // __ADVANCED_WAV_WRITER_H__